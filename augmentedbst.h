@@ -0,0 +1,217 @@
+#ifndef AUGMENTEDBST_H
+#define AUGMENTEDBST_H
+
+#include <utility>
+#include "avlbst.h"
+#include "avl_monoid.h"
+
+/*
+  An AVLTree whose nodes carry a user-defined summary of their subtree, for
+  range aggregates in O(log n).
+
+  Monoid is a summary policy (see avl_monoid.h): SumMonoid, MinMonoid,
+  MaxMonoid, CountMonoid, or any type with the same four members. Each node
+  stores combine(left summary, of(key, value), right summary), kept through
+  AVLTree's augmentation hooks like IntervalTree's max end: recomputed on
+  both nodes of every rotation, and along the path to the root whenever a
+  node is linked, unlinked or swapped, or its value changes.
+
+  aggregate(lo, hi) descends to the highest node inside [lo, hi), then
+  walks the two boundary paths below it, taking whole stored summaries of
+  the subtrees that fall inside the range: O(log n) summaries combined,
+  however many keys the range holds.
+
+  Values must change through the tree so it can refresh the summaries:
+  insert(), upsert(), remove(). operator[] is read-only here and
+  at_or_insert() is not available; writing a value through an iterator
+  leaves the summaries stale.
+*/
+
+/**
+* AVLNode with the summary of its subtree.
+*/
+template <class Key, class Value, class Summary>
+class AugmentedAVLNode : public AVLNode<Key, Value>
+{
+public:
+    AugmentedAVLNode(const Key& key, const Value& value, AVLNode<Key, Value>* parent, const Summary& summary) :
+        AVLNode<Key, Value>(key, value, parent), summary_(summary)
+    {
+    }
+
+    const Summary& getSummary() const { return summary_; }
+    void setSummary(const Summary& summary) { summary_ = summary; }
+
+    AugmentedAVLNode<Key, Value, Summary>* getLeft() const
+    {
+        return static_cast<AugmentedAVLNode<Key, Value, Summary>*>(this->left_);
+    }
+    AugmentedAVLNode<Key, Value, Summary>* getRight() const
+    {
+        return static_cast<AugmentedAVLNode<Key, Value, Summary>*>(this->right_);
+    }
+
+protected:
+    Summary summary_;
+};
+
+template <class Key, class Value, class Monoid, class Stats = NoAVLStats, class Balance = AVLBalance>
+class AugmentedAVLTree : public AVLTree<Key, Value, Stats, Balance>
+{
+public:
+    typedef AVLTree<Key, Value, Stats, Balance> Base;
+    typedef typename Monoid::type Summary;
+    typedef AugmentedAVLNode<Key, Value, Summary> SummaryNode;
+
+    AugmentedAVLTree() { this->augmented_ = true; }
+    // O(n) structural copy; the clones carry their summaries
+    AugmentedAVLTree(const AugmentedAVLTree& other) : Base()
+    {
+        this->augmented_ = true;
+        this->stats_ = other.stats_;
+        this->copyFrom(other);
+    }
+    AugmentedAVLTree(AugmentedAVLTree&& other) = default;
+    AugmentedAVLTree& operator=(const AugmentedAVLTree& other) = default;
+    AugmentedAVLTree& operator=(AugmentedAVLTree&& other) = default;
+    // AVLTree::merge, limited to a tree of the same type: any other
+    // source's nodes carry no summary, or one of another monoid
+    void merge(AugmentedAVLTree&& other) { Base::merge(std::move(other)); }
+    // AVLTree::swap, likewise
+    void swap(AugmentedAVLTree& other) { Base::swap(other); }
+
+    // insert() and upsert() as in BinarySearchTree, refreshing the summaries
+    // above a value they overwrite
+    virtual void insert(const std::pair<const Key, Value>& keyValuePair) override;
+    template<class Fn>
+    bool upsert(const Key& key, Fn fn);
+    // read-only: a write through the reference would bypass the summaries
+    Value const & operator[](const Key& key) const { return Base::operator[](key); }
+    Value& at_or_insert(const Key& key) = delete;
+
+    // summary of the keys in [lo, hi); identity() if there are none
+    Summary aggregate(const Key& lo, const Key& hi) const;
+    // summary of the whole tree, O(1)
+    Summary aggregate() const { return root() ? root()->getSummary() : Monoid::identity(); }
+
+protected:
+    virtual AVLNode<Key, Value>* makeNode(const Key& key, const Value& value, AVLNode<Key, Value>* parent) override
+    {
+        return new SummaryNode(key, value, parent, Monoid::of(key, value));
+    }
+    virtual Node<Key, Value>* cloneNode(const Node<Key, Value>* n, Node<Key, Value>* parent) const override
+    {
+        const SummaryNode* src = static_cast<const SummaryNode*>(n);
+        SummaryNode* c = new SummaryNode(n->getKey(), n->getValue(), static_cast<AVLNode<Key, Value>*>(parent),
+                                         src->getSummary());
+        c->setBalance(src->getBalance());
+        return c;
+    }
+    virtual void updateNode(AVLNode<Key, Value>* n) override;
+
+    // summary of the keys >= lo / < hi in n's subtree, O(height)
+    Summary fromKey(const SummaryNode* n, const Key& lo) const;
+    Summary belowKey(const SummaryNode* n, const Key& hi) const;
+    static Summary summaryOf(const SummaryNode* n) { return n ? n->getSummary() : Monoid::identity(); }
+
+    SummaryNode* root() const { return static_cast<SummaryNode*>(this->root_); }
+};
+
+template<class Key, class Value, class Monoid, class Stats, class Balance>
+void AugmentedAVLTree<Key, Value, Monoid, Stats, Balance>::updateNode(AVLNode<Key, Value>* n)
+{
+    SummaryNode* x = static_cast<SummaryNode*>(n);
+    Summary s = Monoid::of(x->getKey(), x->getValue());
+    if (x->getLeft() != nullptr) s = Monoid::combine(x->getLeft()->getSummary(), s);
+    if (x->getRight() != nullptr) s = Monoid::combine(s, x->getRight()->getSummary());
+    x->setSummary(s);
+}
+
+template<class Key, class Value, class Monoid, class Stats, class Balance>
+void AugmentedAVLTree<Key, Value, Monoid, Stats, Balance>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+    bool created = false;
+    Node<Key, Value>* n = this->findOrInsert(keyValuePair.first, keyValuePair.second, created);
+    if (!created) {
+        n->setValue(keyValuePair.second);
+        this->updatePath(static_cast<AVLNode<Key, Value>*>(n));
+    }
+}
+
+/**
+* BinarySearchTree::upsert, then one walk to the root: fn may have changed
+* the value, whether or not the key was just inserted.
+*/
+template<class Key, class Value, class Monoid, class Stats, class Balance>
+template<class Fn>
+bool AugmentedAVLTree<Key, Value, Monoid, Stats, Balance>::upsert(const Key& key, Fn fn)
+{
+    bool created = false;
+    Node<Key, Value>* n = this->cachedFindOrInsert(key, created);
+    fn(n->getValue());
+    this->updatePath(static_cast<AVLNode<Key, Value>*>(n));
+    return created;
+}
+
+/**
+* Descends while the whole range lies on one side of the node; the first
+* node inside [lo, hi) splits it into fromKey(left, lo), the node itself,
+* and belowKey(right, hi).
+*/
+template<class Key, class Value, class Monoid, class Stats, class Balance>
+typename AugmentedAVLTree<Key, Value, Monoid, Stats, Balance>::Summary
+AugmentedAVLTree<Key, Value, Monoid, Stats, Balance>::aggregate(const Key& lo, const Key& hi) const
+{
+    const SummaryNode* n = root();
+    while (n != nullptr) {
+        if (n->getKey() < lo) n = n->getRight();
+        else if (!(n->getKey() < hi)) n = n->getLeft();
+        else {
+            Summary s = Monoid::combine(fromKey(n->getLeft(), lo), Monoid::of(n->getKey(), n->getValue()));
+            return Monoid::combine(s, belowKey(n->getRight(), hi));
+        }
+    }
+    return Monoid::identity();
+}
+
+/**
+* Walks toward lo. A node >= lo is in, with its whole right subtree; those
+* keys come after everything found further down, hence combine(x, s).
+*/
+template<class Key, class Value, class Monoid, class Stats, class Balance>
+typename AugmentedAVLTree<Key, Value, Monoid, Stats, Balance>::Summary
+AugmentedAVLTree<Key, Value, Monoid, Stats, Balance>::fromKey(const SummaryNode* n, const Key& lo) const
+{
+    Summary s = Monoid::identity();
+    while (n != nullptr) {
+        if (n->getKey() < lo) n = n->getRight();
+        else {
+            Summary x = Monoid::combine(Monoid::of(n->getKey(), n->getValue()), summaryOf(n->getRight()));
+            s = Monoid::combine(x, s);
+            n = n->getLeft();
+        }
+    }
+    return s;
+}
+
+/**
+* The mirror image: a node < hi is in, with its whole left subtree, after
+* everything found so far.
+*/
+template<class Key, class Value, class Monoid, class Stats, class Balance>
+typename AugmentedAVLTree<Key, Value, Monoid, Stats, Balance>::Summary
+AugmentedAVLTree<Key, Value, Monoid, Stats, Balance>::belowKey(const SummaryNode* n, const Key& hi) const
+{
+    Summary s = Monoid::identity();
+    while (n != nullptr) {
+        if (n->getKey() < hi) {
+            Summary x = Monoid::combine(summaryOf(n->getLeft()), Monoid::of(n->getKey(), n->getValue()));
+            s = Monoid::combine(s, x);
+            n = n->getRight();
+        }
+        else n = n->getLeft();
+    }
+    return s;
+}
+
+#endif
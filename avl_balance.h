@@ -0,0 +1,213 @@
+#ifndef AVL_BALANCE_H
+#define AVL_BALANCE_H
+
+#include <cstdint>
+#include <algorithm>
+#include "avl_trace.h"
+
+/*
+  Balance policies for AVLTree (the fourth template parameter).
+
+  The tree does the descent, linking and unlinking; the policy restores its
+  invariant afterwards through the tree's rotateLeft()/rotateRight(). All
+  policies share AVLNode and keep their per-node tag in its balance__ field:
+
+    AVLBalance   height balance right - left, in {-1, 0, 1}. A delete may
+                 rotate at every level on the way up (O(log n) rotations).
+    WAVLBalance  weak-AVL rank (Haeupler, Sen, Tarjan). Every rank
+                 difference parent - child is 1 or 2 (a missing child has
+                 rank -1) and leaves have rank 0. Inserts behave like AVL,
+                 but a delete does at most two rotations, and promotions /
+                 demotions are O(1) amortized. Ranks stay below 2 log2 n,
+                 so they fit the int8_t field.
+
+  A policy provides
+    afterInsert(tree, parent, node)         node was just linked under parent
+    afterRemove(tree, parent, child, diff)  a node was unlinked from parent and
+                                            replaced by child (maybe null); diff
+                                            is +1 if it was the left child, -1
+                                            if the right one
+    fromHeights(node, lh, rh)               set node's tag in a tree built
+                                            from scratch, given the heights
+                                            of its subtrees (0 if empty)
+*/
+
+/**
+ * The original AVL rebalancing: insertFix / removeFix.
+ */
+struct AVLBalance
+{
+    static const char* name() { return "avl"; }
+
+    template<class Tree, class N>
+    static void afterInsert(Tree& t, N* parent, N* node)
+    {
+        // Determine the balance change (diff) at the parent
+        int8_t diff = (node == parent->getLeft() ? -1 : 1); // Note: diff is -1 for left, +1 for right
+
+        // Case A: Parent's balance was 0
+        if (parent->getBalance() == 0) {
+            parent->updateBalance(diff);
+            // Height of parent's subtree increased, continue fix up.
+            t.insertFix(parent->getParent(), parent); // Propagate up
+        }
+        // Case B: Parent's balance was -diff (now it's 0)
+        else if (parent->getBalance() == -diff) {
+            // Parent's balance becomes 0. Height didn't change (it went from 1/0 to 1/1).
+            parent->setBalance(0);
+            // Stop propagation.
+        }
+        // Case C: Parent's balance was diff (now it becomes ±2)
+        else { // parent->getBalance() == diff
+            // Unbalanced → parent's balance is now ±2.
+            parent->updateBalance(diff); // Now parent is ±2 (e.g., -1 to -2)
+            // Call fix. insertFix must check if the grand's balance is already ±2 and skip the update.
+            t.insertFix(parent, node);
+        }
+    }
+
+    template<class Tree, class N>
+    static void afterRemove(Tree& t, N* parent, N*, int8_t diff)
+    {
+        t.removeFix(parent, diff);
+    }
+
+    template<class N>
+    static void fromHeights(N* n, int lh, int rh) { n->setBalance(int8_t(rh - lh)); }
+};
+
+/**
+ * Weak-AVL (rank-balanced) rebalancing.
+ */
+struct WAVLBalance
+{
+    static const char* name() { return "wavl"; }
+
+    template<class N>
+    static int rank(const N* n) { return n ? n->getBalance() : -1; }
+
+    template<class N>
+    static void promote(N* n, int by = 1) { n->setBalance(int8_t(n->getBalance() + by)); }
+
+    template<class N>
+    static void demote(N* n, int by = 1) { n->setBalance(int8_t(n->getBalance() - by)); }
+
+    // rank = height - 1 is a valid WAVL ranking of any AVL-shaped tree
+    template<class N>
+    static void fromHeights(N* n, int lh, int rh) { n->setBalance(int8_t(std::max(lh, rh))); }
+
+    // New leaves have rank 0. While the new node (or a promoted one) has the
+    // same rank as its parent, promote the parent if the sibling is a
+    // 1-child; otherwise one single or double rotation finishes the insert.
+    template<class Tree, class N>
+    static void afterInsert(Tree& t, N* parent, N* node)
+    {
+        N* x = node;
+        N* p = parent;
+        while (p != nullptr && rank(p) == rank(x)) {
+            bool xLeft = (p->getLeft() == x);
+            N* sibling = xLeft ? p->getRight() : p->getLeft();
+            if (rank(p) - rank(sibling) == 1) {
+                t.stats_.insertFixStep();
+                AVL_TRACE_EVENT(TRACE_INSERT_FIX, p->getKey(), p, rank(p), rank(p) + 1);
+                promote(p);
+                x = p;
+                p = p->getParent();
+                continue;
+            }
+            // sibling is a 2-child: rotate x up
+            N* inner = xLeft ? x->getRight() : x->getLeft();
+            if (inner == nullptr || rank(x) - rank(inner) == 2) {
+                t.stats_.singleRotation();
+                if (xLeft) t.rotateRight(p);
+                else t.rotateLeft(p);
+                demote(p);
+            }
+            else {
+                t.stats_.doubleRotation();
+                if (xLeft) {
+                    t.rotateLeft(x);
+                    t.rotateRight(p);
+                }
+                else {
+                    t.rotateRight(x);
+                    t.rotateLeft(p);
+                }
+                promote(inner);
+                demote(x);
+                demote(p);
+            }
+            break;
+        }
+    }
+
+    // The removed node's slot is now child. A parent left as a rank-1 leaf
+    // is demoted; then, while the climbing node is a 3-child, demote its
+    // parent (once, or together with a 2,2 sibling) or rotate once or twice
+    // and stop.
+    template<class Tree, class N>
+    static void afterRemove(Tree& t, N* parent, N* child, int8_t diff)
+    {
+        N* p = parent;
+        N* x = child;
+        bool xLeft = (diff > 0);
+        if (p == nullptr) return;
+
+        if (p->getLeft() == nullptr && p->getRight() == nullptr && rank(p) == 1) {
+            t.stats_.removeFixStep();
+            AVL_TRACE_EVENT(TRACE_REMOVE_FIX, p->getKey(), p, 1, 0);
+            demote(p);
+            x = p;
+            p = p->getParent();
+            if (p) xLeft = (p->getLeft() == x);
+        }
+
+        while (p != nullptr && rank(p) - rank(x) == 3) {
+            N* y = xLeft ? p->getRight() : p->getLeft();
+            if (rank(p) - rank(y) == 2) {
+                t.stats_.removeFixStep();
+                AVL_TRACE_EVENT(TRACE_REMOVE_FIX, p->getKey(), p, rank(p), rank(p) - 1);
+                demote(p);
+            }
+            else {
+                N* inner = xLeft ? y->getLeft() : y->getRight();
+                N* outer = xLeft ? y->getRight() : y->getLeft();
+                if (rank(y) - rank(inner) == 2 && rank(y) - rank(outer) == 2) {
+                    t.stats_.removeFixStep();
+                    AVL_TRACE_EVENT(TRACE_REMOVE_FIX, p->getKey(), p, rank(p), rank(p) - 1);
+                    demote(p);
+                    demote(y);
+                }
+                else if (rank(y) - rank(outer) == 1) {
+                    t.stats_.singleRotation();
+                    if (xLeft) t.rotateLeft(p);
+                    else t.rotateRight(p);
+                    promote(y);
+                    demote(p);
+                    if (p->getLeft() == nullptr && p->getRight() == nullptr) demote(p);
+                    return;
+                }
+                else {
+                    t.stats_.doubleRotation();
+                    if (xLeft) {
+                        t.rotateRight(y);
+                        t.rotateLeft(p);
+                    }
+                    else {
+                        t.rotateLeft(y);
+                        t.rotateRight(p);
+                    }
+                    promote(inner, 2);
+                    demote(y);
+                    demote(p, 2);
+                    return;
+                }
+            }
+            x = p;
+            p = p->getParent();
+            if (p) xLeft = (p->getLeft() == x);
+        }
+    }
+};
+
+#endif
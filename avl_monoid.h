@@ -0,0 +1,74 @@
+#ifndef AVL_MONOID_H
+#define AVL_MONOID_H
+
+#include <cstddef>
+#include <limits>
+
+/*
+  Summary policies for AugmentedAVLTree (see augmentedbst.h).
+
+  A summary is a monoid: an associative combine() with an identity(). Every
+  node stores the summary of its subtree, so the summary of any key range
+  is the combination of O(log n) stored values. combine(a, b) always gets
+  the summary of the smaller keys as a, so it need not be commutative
+  (e.g. "first value in the range" works as well as a sum).
+
+  A policy provides
+    type                          the summary's type
+    identity()                    summary of an empty range
+    of(key, value)                summary of a single item
+    combine(a, b)                 summary of a range made of a's then b's
+*/
+
+/**
+ * Sum of the values, accumulated in T (e.g. long long over int values).
+ */
+template <class T>
+struct SumMonoid
+{
+    typedef T type;
+    static T identity() { return T(); }
+    template <class Key, class Value>
+    static T of(const Key&, const Value& v) { return T(v); }
+    static T combine(const T& a, const T& b) { return a + b; }
+};
+
+/**
+ * Smallest value; identity() is T's largest value.
+ */
+template <class T>
+struct MinMonoid
+{
+    typedef T type;
+    static T identity() { return std::numeric_limits<T>::max(); }
+    template <class Key, class Value>
+    static T of(const Key&, const Value& v) { return T(v); }
+    static T combine(const T& a, const T& b) { return b < a ? b : a; }
+};
+
+/**
+ * Largest value; identity() is T's lowest value.
+ */
+template <class T>
+struct MaxMonoid
+{
+    typedef T type;
+    static T identity() { return std::numeric_limits<T>::lowest(); }
+    template <class Key, class Value>
+    static T of(const Key&, const Value& v) { return T(v); }
+    static T combine(const T& a, const T& b) { return a < b ? b : a; }
+};
+
+/**
+ * Number of items: aggregate(lo, hi) counts the keys in the range.
+ */
+struct CountMonoid
+{
+    typedef size_t type;
+    static size_t identity() { return 0; }
+    template <class Key, class Value>
+    static size_t of(const Key&, const Value&) { return 1; }
+    static size_t combine(size_t a, size_t b) { return a + b; }
+};
+
+#endif
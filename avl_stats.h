@@ -0,0 +1,117 @@
+#ifndef AVL_STATS_H
+#define AVL_STATS_H
+
+#include <iostream>
+#include <cstdint>
+
+/*
+  Stats policies for AVLTree (the third template parameter).
+
+  AVLTree calls the hooks below from its hot paths. NoAVLStats is the
+  default; its hooks are empty inline functions so the calls compile away.
+  AVLStats keeps plain counters that can be read through AVLTree::stats().
+*/
+
+/**
+ * The default policy: records nothing.
+ */
+struct NoAVLStats
+{
+    void insertCall() {}
+    void removeCall() {}
+    void comparison() {}
+    void descend() {}
+    void rotateLeftCall() {}
+    void rotateRightCall() {}
+    void singleRotation() {}
+    void doubleRotation() {}
+    void insertFixStep() {}
+    void removeFixStep() {}
+    void fixDone() {}
+    void reset() {}
+};
+
+/**
+ * Counts comparisons, descent length, rotations and retracing work.
+ */
+struct AVLStats
+{
+    uint64_t inserts;          // insert() calls
+    uint64_t removes;          // remove() calls
+    uint64_t comparisons;      // key comparisons made while descending
+    uint64_t descentSteps;     // nodes visited while descending
+    uint64_t rotateLefts;      // rotateLeft() calls
+    uint64_t rotateRights;     // rotateRight() calls
+    uint64_t singleRotations;  // LL / RR fixes
+    uint64_t doubleRotations;  // LR / RL fixes
+    uint64_t insertFixSteps;   // levels visited by insertFix
+    uint64_t removeFixSteps;   // levels visited by removeFix
+    uint64_t maxFixChain;      // longest single insertFix/removeFix propagation
+
+    AVLStats() { reset(); }
+
+    void insertCall() { ++inserts; }
+    void removeCall() { ++removes; }
+    void comparison() { ++comparisons; }
+    void descend() { ++descentSteps; }
+    void rotateLeftCall() { ++rotateLefts; }
+    void rotateRightCall() { ++rotateRights; }
+    void singleRotation() { ++singleRotations; }
+    void doubleRotation() { ++doubleRotations; }
+    void insertFixStep() { ++insertFixSteps; ++chain_; }
+    void removeFixStep() { ++removeFixSteps; ++chain_; }
+
+    // called when a retrace finishes, to track the longest one
+    void fixDone()
+    {
+        if (chain_ > maxFixChain) maxFixChain = chain_;
+        chain_ = 0;
+    }
+
+    void reset()
+    {
+        inserts = removes = comparisons = descentSteps = 0;
+        rotateLefts = rotateRights = singleRotations = doubleRotations = 0;
+        insertFixSteps = removeFixSteps = maxFixChain = 0;
+        chain_ = 0;
+    }
+
+    /**
+     * Calls f(name, value) for every counter, for export to a metrics sink.
+     */
+    template<class F>
+    void forEach(F f) const
+    {
+        f("inserts", inserts);
+        f("removes", removes);
+        f("comparisons", comparisons);
+        f("descent_steps", descentSteps);
+        f("rotate_left", rotateLefts);
+        f("rotate_right", rotateRights);
+        f("single_rotations", singleRotations);
+        f("double_rotations", doubleRotations);
+        f("insert_fix_steps", insertFixSteps);
+        f("remove_fix_steps", removeFixSteps);
+        f("max_fix_chain", maxFixChain);
+    }
+
+private:
+    uint64_t chain_;
+};
+
+/**
+ * Prints the counters as "name=value" lines.
+ */
+inline std::ostream& operator<<(std::ostream& os, const AVLStats& s)
+{
+    struct Printer
+    {
+        std::ostream& os;
+        void operator()(const char* name, uint64_t v) const { os << name << "=" << v << "\n"; }
+    };
+    Printer p = { os };
+    s.forEach(p);
+    return os;
+}
+
+#endif
@@ -0,0 +1,263 @@
+#ifndef AVL_TRACE_H
+#define AVL_TRACE_H
+
+#include <iostream>
+#include <iomanip>
+#include <atomic>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+#include <csignal>
+#include <unistd.h>
+
+/*
+  Event trace for AVLTree, enabled with -DDEBUG or -DAVL_TRACE.
+
+  Instead of printing the whole tree on every operation, AVLTree records
+  one fixed-size event per step into a process-wide ring buffer. Writers
+  claim a slot with one atomic fetch_add and never block; each slot has a
+  sequence stamp so a reader can detect and skip slots being overwritten.
+  The most recent AVL_TRACE_CAPACITY events can be dumped on demand with
+  avlTrace().dump(std::cerr), or on a crash after
+  avlTraceInstallCrashHandler().
+
+  Keys are recorded as their std::hash, or as the node's address for key
+  types that have no hash.
+
+  Meaning of the two balance fields per op:
+    insert / remove        parent's balance before and after rebalancing
+    insert_fix/remove_fix  node's balance before and after the update
+    rotate_left/right      balance of the rotated node and of its child
+    node_swap              first node's balance before and after the swap
+*/
+
+#ifndef AVL_TRACE_CAPACITY
+#define AVL_TRACE_CAPACITY 4096
+#endif
+
+enum AVLTraceOp
+{
+    TRACE_INSERT,
+    TRACE_REMOVE,
+    TRACE_INSERT_FIX,
+    TRACE_REMOVE_FIX,
+    TRACE_ROTATE_LEFT,
+    TRACE_ROTATE_RIGHT,
+    TRACE_NODE_SWAP
+};
+
+inline const char* avlTraceOpName(unsigned op)
+{
+    static const char* const names[] = {
+        "insert", "remove", "insert_fix", "remove_fix", "rotate_left", "rotate_right", "node_swap"
+    };
+    return op < sizeof(names) / sizeof(names[0]) ? names[op] : "?";
+}
+
+/**
+ * A decoded trace record.
+ */
+struct AVLTraceEvent
+{
+    uint64_t seq;
+    uint64_t keyHash;
+    const void* node;
+    uint8_t op;
+    int8_t balanceBefore;
+    int8_t balanceAfter;
+};
+
+/**
+ * Fixed-size, lock-free, overwrite-oldest ring of trace events.
+ * Capacity must be a power of two.
+ */
+template<size_t Capacity>
+class AVLTraceRing
+{
+    static_assert(Capacity != 0 && (Capacity & (Capacity - 1)) == 0,
+                  "AVLTraceRing capacity must be a power of two");
+public:
+    AVLTraceRing() : next_(0)
+    {
+        for (size_t i = 0; i < Capacity; ++i) slots_[i].stamp.store(0, std::memory_order_relaxed);
+    }
+
+    void record(AVLTraceOp op, uint64_t keyHash, const void* node, int8_t before, int8_t after)
+    {
+        uint64_t seq = next_.fetch_add(1, std::memory_order_relaxed);
+        Slot& s = slots_[seq & (Capacity - 1)];
+        s.stamp.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        s.keyHash.store(keyHash, std::memory_order_relaxed);
+        s.node.store(reinterpret_cast<uintptr_t>(node), std::memory_order_relaxed);
+        s.packed.store(uint64_t(uint8_t(op)) | (uint64_t(uint8_t(before)) << 8) | (uint64_t(uint8_t(after)) << 16),
+                       std::memory_order_relaxed);
+        s.stamp.store(seq + 1, std::memory_order_release);
+    }
+
+    // number of events recorded since start (including overwritten ones)
+    uint64_t recorded() const { return next_.load(std::memory_order_relaxed); }
+
+    /**
+     * Reads event seq into out. Returns false if it was overwritten or
+     * is still being written.
+     */
+    bool read(uint64_t seq, AVLTraceEvent& out) const
+    {
+        const Slot& s = slots_[seq & (Capacity - 1)];
+        uint64_t stamp = s.stamp.load(std::memory_order_acquire);
+        out.keyHash = s.keyHash.load(std::memory_order_relaxed);
+        out.node = reinterpret_cast<const void*>(s.node.load(std::memory_order_relaxed));
+        uint64_t packed = s.packed.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (stamp != seq + 1 || s.stamp.load(std::memory_order_relaxed) != stamp) return false;
+        out.seq = seq;
+        out.op = uint8_t(packed);
+        out.balanceBefore = int8_t(uint8_t(packed >> 8));
+        out.balanceAfter = int8_t(uint8_t(packed >> 16));
+        return true;
+    }
+
+    /**
+     * Prints the retained events, oldest first.
+     */
+    void dump(std::ostream& os) const
+    {
+        uint64_t end = recorded();
+        uint64_t begin = end > Capacity ? end - Capacity : 0;
+        std::ios::fmtflags flags(os.flags());
+        os << "AVL trace: events " << begin << ".." << end << std::endl;
+        for (uint64_t seq = begin; seq < end; ++seq) {
+            AVLTraceEvent e;
+            if (!read(seq, e)) continue;
+            os << std::dec << e.seq << ' ' << avlTraceOpName(e.op)
+               << " key#=" << std::hex << e.keyHash
+               << " node=" << e.node << std::dec
+               << " b=" << int(e.balanceBefore) << "->" << int(e.balanceAfter) << std::endl;
+        }
+        os.flags(flags);
+    }
+
+    /**
+     * Same as dump() but only uses write(2), so it is safe in a signal handler.
+     */
+    void dumpRaw(int fd) const
+    {
+        uint64_t end = recorded();
+        uint64_t begin = end > Capacity ? end - Capacity : 0;
+        writeStr(fd, "AVL trace (crash dump):\n");
+        for (uint64_t seq = begin; seq < end; ++seq) {
+            AVLTraceEvent e;
+            if (!read(seq, e)) continue;
+            writeNum(fd, e.seq, 10);
+            writeStr(fd, " ");
+            writeStr(fd, avlTraceOpName(e.op));
+            writeStr(fd, " key#=");
+            writeNum(fd, e.keyHash, 16);
+            writeStr(fd, " node=0x");
+            writeNum(fd, reinterpret_cast<uintptr_t>(e.node), 16);
+            writeStr(fd, " b=");
+            writeInt(fd, e.balanceBefore);
+            writeStr(fd, "->");
+            writeInt(fd, e.balanceAfter);
+            writeStr(fd, "\n");
+        }
+    }
+
+private:
+    struct Slot
+    {
+        std::atomic<uint64_t> stamp;    // seq + 1 once complete, 0 while being written
+        std::atomic<uint64_t> keyHash;
+        std::atomic<uintptr_t> node;
+        std::atomic<uint64_t> packed;   // op | before << 8 | after << 16
+    };
+
+    static void writeStr(int fd, const char* s)
+    {
+        size_t len = 0;
+        while (s[len] != '\0') ++len;
+        ssize_t ignored = ::write(fd, s, len);
+        (void)ignored;
+    }
+
+    static void writeNum(int fd, uint64_t v, unsigned base)
+    {
+        char buf[24];
+        size_t i = sizeof(buf);
+        buf[--i] = '\0';
+        do {
+            buf[--i] = "0123456789abcdef"[v % base];
+            v /= base;
+        } while (v != 0);
+        writeStr(fd, buf + i);
+    }
+
+    static void writeInt(int fd, int v)
+    {
+        if (v < 0) {
+            writeStr(fd, "-");
+            v = -v;
+        }
+        writeNum(fd, uint64_t(v), 10);
+    }
+
+    std::atomic<uint64_t> next_;
+    Slot slots_[Capacity];
+};
+
+/**
+ * The process-wide trace ring used by AVLTree.
+ */
+inline AVLTraceRing<AVL_TRACE_CAPACITY>& avlTrace()
+{
+    static AVLTraceRing<AVL_TRACE_CAPACITY> ring;
+    return ring;
+}
+
+/**
+ * std::hash of the key when Key has one; otherwise (the second overload,
+ * picked by SFINAE) the node's address, so tracing needs nothing from the
+ * key type. Called with 0 so the first overload wins when both apply.
+ */
+template<typename Key>
+auto avlTraceKeyHash(const Key& key, const void*, int) -> decltype(uint64_t(std::hash<Key>()(key)))
+{
+    return uint64_t(std::hash<Key>()(key));
+}
+
+template<typename Key>
+uint64_t avlTraceKeyHash(const Key&, const void* node, long)
+{
+    return uint64_t(reinterpret_cast<uintptr_t>(node));
+}
+
+extern "C" inline void avlTraceCrashHandler(int sig)
+{
+    avlTrace().dumpRaw(STDERR_FILENO);
+    std::signal(sig, SIG_DFL);
+    std::raise(sig);
+}
+
+/**
+ * Dumps the trace to stderr if the process dies from SIGSEGV, SIGBUS,
+ * SIGFPE, SIGILL or SIGABRT (e.g. a failed assert), then re-raises.
+ */
+inline void avlTraceInstallCrashHandler()
+{
+    avlTrace();
+    std::signal(SIGSEGV, avlTraceCrashHandler);
+    std::signal(SIGBUS, avlTraceCrashHandler);
+    std::signal(SIGFPE, avlTraceCrashHandler);
+    std::signal(SIGILL, avlTraceCrashHandler);
+    std::signal(SIGABRT, avlTraceCrashHandler);
+}
+
+#if defined(DEBUG) || defined(AVL_TRACE)
+#define AVL_TRACE_EVENT(op, key, node, before, after) \
+    avlTrace().record((op), avlTraceKeyHash((key), (node), 0), (node), int8_t(before), int8_t(after))
+#else
+#define AVL_TRACE_EVENT(op, key, node, before, after) ((void)0)
+#endif
+
+#endif
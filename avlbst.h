@@ -6,7 +6,11 @@
 #include <cstdlib>
 #include <cstdint>
 #include <algorithm>
+#include <vector>
 #include "bst.h"
+#include "avl_stats.h"
+#include "avl_trace.h"
+#include "avl_balance.h"
 
 struct KeyError { };
 
@@ -129,96 +133,133 @@ AVLNode<Key, Value> *AVLNode<Key, Value>::getRight() const
 */
 
 
-template <class Key, class Value>
+/**
+* An AVL tree. Stats is a compile-time instrumentation policy (see avl_stats.h):
+* the default NoAVLStats compiles to nothing, AVLStats counts comparisons,
+* rotations and retracing work, readable through stats().
+* Balance is the rebalancing policy (see avl_balance.h): AVLBalance by
+* default, or WAVLBalance for O(1) amortized rebalancing work per delete.
+*/
+template <class Key, class Value, class Stats = NoAVLStats, class Balance = AVLBalance>
 class AVLTree : public BinarySearchTree<Key, Value>
 {
+    friend Balance;
 public:
-    virtual void insert (const std::pair<const Key, Value> &new_item);
+    AVLTree() {}
+    // O(n) structural copy: same shape and balance tags, no rebalancing
+    AVLTree(const AVLTree& other) :
+        BinarySearchTree<Key, Value>(), stats_(other.stats_), augmented_(other.augmented_)
+    {
+        this->copyFrom(other);
+    }
+    AVLTree(AVLTree&& other) = default;
+    AVLTree& operator=(const AVLTree& other) = default;
+    AVLTree& operator=(AVLTree&& other) = default;
+    void swap(AVLTree& other)
+    {
+        BinarySearchTree<Key, Value>::swap(other);
+        std::swap(stats_, other.stats_);
+    }
+
+    // moves other's nodes into this tree without allocating (see below)
+    void merge(AVLTree&& other);
+
+    // BinarySearchTree::rebalance, then fresh balance tags (and summaries)
+    virtual void rebalance() override;
+
+    // insert() is BinarySearchTree's; it goes through findOrInsert below
     virtual void remove(const Key& key);
+
+    // counters collected by the Stats policy
+    const Stats& stats() const { return stats_; }
+    void resetStats() { stats_.reset(); }
 protected:
     virtual void nodeSwap( AVLNode<Key,Value>* n1, AVLNode<Key,Value>* n2);
+    virtual Node<Key, Value>* findOrInsert(const Key& k, const Value& v, bool& created) override;
+    AVLNode<Key, Value>* findSlot(const Key& k, AVLNode<Key, Value>*& parent);
+    void linkNode(AVLNode<Key, Value>* parent, AVLNode<Key, Value>* n);
+    AVLNode<Key, Value>* buildBalanced(const std::vector<AVLNode<Key, Value>*>& nodes, size_t lo, size_t hi,
+                                       AVLNode<Key, Value>* parent, int& height);
+    // rebalance(): a tag slot that holds its subtree's height (0 if empty)
+    static int heightTag(const AVLNode<Key, Value>* n) { return n ? n->getBalance() : 0; }
+    virtual Node<Key, Value>* cloneNode(const Node<Key, Value>* n, Node<Key, Value>* parent) const override
+    {
+        AVLNode<Key, Value>* c = new AVLNode<Key, Value>(n->getKey(), n->getValue(),
+                                                         static_cast<AVLNode<Key, Value>*>(parent));
+        c->setBalance(static_cast<const AVLNode<Key, Value>*>(n)->getBalance());
+        return c;
+    }
+    // allocates every node insert() links in; derived trees may return a
+    // subclass of AVLNode that carries extra per-node data
+    virtual AVLNode<Key, Value>* makeNode(const Key& key, const Value& value, AVLNode<Key, Value>* parent)
+    {
+        return new AVLNode<Key, Value>(key, value, parent);
+    }
 
     // Add helper functions here
     void insertFix(AVLNode<Key, Value>* grand, AVLNode<Key, Value>* parent);
     void rotateLeft(AVLNode<Key, Value>* n);
     void rotateRight(AVLNode<Key, Value>* n);
     void removeFix(AVLNode<Key, Value>* n, int8_t diff);
+    AVLNode<Key, Value>* findNode(const Key& key);
+    virtual bool nodeBalance(const Node<Key, Value>* n, int& balance) const override;
+
+    // Augmentation: a derived tree that keeps per-node data summarising the
+    // node's subtree (see intervalbst.h) sets augmented_ and overrides
+    // updateNode() to recompute n's data from its own and its children's.
+    // The tree then calls it wherever a subtree changes: on both nodes of a
+    // rotation, and on every node from a linked, unlinked or swapped node
+    // up to the root. Plain trees leave augmented_ false and skip the walks.
+    virtual void updateNode(AVLNode<Key, Value>* n) { (void)n; }
+    void updatePath(AVLNode<Key, Value>* n)
+    {
+        if (!augmented_) return;
+        for (; n != nullptr; n = n->getParent()) updateNode(n);
+    }
 
-    void debugPrint() const;
-    void printInOrderHelper(Node<Key,Value>* node) const;
+    Stats stats_;
+    bool augmented_ = false;
 };
 
 
 
-// Rotations
-template<class Key, class Value>
-void AVLTree<Key, Value>::rotateLeft(AVLNode<Key, Value>* n) {
-#ifdef DEBUG
-std::cout << "start rotate l fn - printing AVL in-order" << std::endl;
-this->debugPrint();
-#endif
-
+// Rotations: the generic BinarySearchTree ones, reported to Stats and the trace
+template<class Key, class Value, class Stats, class Balance>
+void AVLTree<Key, Value, Stats, Balance>::rotateLeft(AVLNode<Key, Value>* n) {
     if (!n) return;
     AVLNode<Key, Value>* r = n->getRight();
     if (!r) return;
-    AVLNode<Key, Value>* rl = r->getLeft();
-
-    r->setLeft(n);
-    AVLNode<Key, Value>* parent = n->getParent();
-    r->setParent(parent);
-    n->setParent(r);
-
-    n->setRight(rl);
-    if (rl) rl->setParent(n);
-
-    if (!parent) this->root_ = r;
-    else if (parent->getLeft() == n) parent->setLeft(r);
-    else parent->setRight(r);
-    
-#ifdef DEBUG
-std::cout << "end rotate l fn - printing AVL in-order" << std::endl;
-this->debugPrint();
-#endif
+    stats_.rotateLeftCall();
+    AVL_TRACE_EVENT(TRACE_ROTATE_LEFT, n->getKey(), n, n->getBalance(), r->getBalance());
+    BinarySearchTree<Key, Value>::rotateLeft(n);
+    if (augmented_) {
+        updateNode(n);
+        updateNode(r);
+    }
 }
 
-template<class Key, class Value>
-void AVLTree<Key, Value>::rotateRight(AVLNode<Key, Value>* n) {
-
-#ifdef DEBUG
-std::cout << "start rotate right fn - printing AVL in-order" << std::endl;
-this->debugPrint();
-#endif
-
+template<class Key, class Value, class Stats, class Balance>
+void AVLTree<Key, Value, Stats, Balance>::rotateRight(AVLNode<Key, Value>* n) {
     if (!n) return;
     AVLNode<Key, Value>* l = n->getLeft();
     if (!l) return;
-    AVLNode<Key, Value>* lr = l->getRight();
-
-    l->setRight(n);
-    AVLNode<Key, Value>* parent = n->getParent();
-    l->setParent(parent);
-    n->setParent(l);
-
-    n->setLeft(lr);
-    if (lr) lr->setParent(n);
-
-    if (!parent) this->root_ = l;
-    else if (parent->getLeft() == n) parent->setLeft(l);
-    else parent->setRight(l);
-
-#ifdef DEBUG
-std::cout << "end rotate right fn - printing AVL in-order" << std::endl;
-this->debugPrint();
-#endif
+    stats_.rotateRightCall();
+    AVL_TRACE_EVENT(TRACE_ROTATE_RIGHT, n->getKey(), n, n->getBalance(), l->getBalance());
+    BinarySearchTree<Key, Value>::rotateRight(n);
+    if (augmented_) {
+        updateNode(n);
+        updateNode(l);
+    }
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-template<class Key, class Value>
-void AVLTree<Key, Value>::insertFix(AVLNode<Key, Value>* grand, AVLNode<Key, Value>* parent) {
+template<class Key, class Value, class Stats, class Balance>
+void AVLTree<Key, Value, Stats, Balance>::insertFix(AVLNode<Key, Value>* grand, AVLNode<Key, Value>* parent) {
 // grand: the node whose balance we are currently checking/fixing.
 // parent: the child of grand that caused the height increase (i.e., the node whose balance we just fixed).
 
     if (grand == nullptr) return;
+    stats_.insertFixStep();
 
     // Determine balance change (diff) at grand due to parent's height increase
     int8_t diff;
@@ -233,6 +274,7 @@ void AVLTree<Key, Value>::insertFix(AVLNode<Key, Value>* grand, AVLNode<Key, Val
     if (grand->getBalance() != -2 && grand->getBalance() != 2) {
         grand->updateBalance(diff);
     }
+    AVL_TRACE_EVENT(TRACE_INSERT_FIX, grand->getKey(), grand, grand->getBalance() - diff, grand->getBalance());
 
     int8_t gb = grand->getBalance();
 
@@ -253,11 +295,13 @@ void AVLTree<Key, Value>::insertFix(AVLNode<Key, Value>* grand, AVLNode<Key, Val
     if (gb == -2) { // Left subtree is too tall
         if (parent->getBalance() == -1) { 
             // Left-Left (zig-zig)
+            stats_.singleRotation();
             rotateRight(grand);
             parent->setBalance(0);
             grand->setBalance(0);
         } else { // parent->getBalance() == 1
             // Left-Right (zig-zag)
+            stats_.doubleRotation();
             AVLNode<Key, Value>* lr = parent->getRight();
             rotateLeft(parent); // This changes parent's right child to lr, and lr's parent to parent
             rotateRight(grand);
@@ -271,11 +315,13 @@ void AVLTree<Key, Value>::insertFix(AVLNode<Key, Value>* grand, AVLNode<Key, Val
     } else if (gb == 2) { // Right subtree is too tall
         if (parent->getBalance() == 1) {
             // Right-Right (zig-zig)
+            stats_.singleRotation();
             rotateLeft(grand);
             parent->setBalance(0);
             grand->setBalance(0);
         } else { // parent->getBalance() == -1
             // Right-Left (zig-zag)
+            stats_.doubleRotation();
             AVLNode<Key, Value>* rl = parent->getLeft();
             rotateRight(parent);
             rotateLeft(grand);
@@ -290,93 +336,213 @@ void AVLTree<Key, Value>::insertFix(AVLNode<Key, Value>* grand, AVLNode<Key, Val
 }
 
 
-template<class Key, class Value>
-void AVLTree<Key, Value>::insert(const std::pair<const Key, Value>& new_item) {
-#ifdef DEBUG
-std::cout << "start insert fn - printing AVL in-order" << std::endl;
-this->debugPrint();
-#endif
-
-    Key k = new_item.first;
-    Value v = new_item.second;
+/**
+* The descent of insert(), at_or_insert() and upsert(): returns the node
+* holding k, or links a new one and rebalances. An existing key costs no
+* rebalancing work.
+*/
+template<class Key, class Value, class Stats, class Balance>
+Node<Key, Value>* AVLTree<Key, Value, Stats, Balance>::findOrInsert(const Key& k, const Value& v, bool& created) {
+    stats_.insertCall();
+    created = false;
 
-    // empty tree
-    if (this->root_ == nullptr) {
-        this->root_ = new AVLNode<Key, Value>(k, v, nullptr);
-#ifdef DEBUG
-std::cout << "end insert fn - ROOT = NULLPTR - printing AVL in-order" << std::endl;
-this->debugPrint();
-#endif
-        return;
+    AVLNode<Key, Value>* parent = nullptr;
+    AVLNode<Key, Value>* curr = findSlot(k, parent);
+    if (curr != nullptr) { // key exists
+        AVL_TRACE_EVENT(TRACE_INSERT, k, curr, curr->getBalance(), curr->getBalance());
+        return curr;
     }
 
-    // find insertion point
-    AVLNode<Key, Value>* curr = static_cast<AVLNode<Key, Value>*>(this->root_);
-    AVLNode<Key, Value>* parent = nullptr;
+    //at this point we are at a leaf (or the tree is empty)
+    AVLNode<Key, Value>* newNode = makeNode(k, v, parent);
+    linkNode(parent, newNode);
+    created = true;
+    return newNode;
+}
 
+/**
+* Descends toward k: returns the node holding it, or nullptr with parent
+* set to the node a new k would hang under (nullptr for an empty tree).
+*/
+template<class Key, class Value, class Stats, class Balance>
+AVLNode<Key, Value>* AVLTree<Key, Value, Stats, Balance>::findSlot(const Key& k, AVLNode<Key, Value>*& parent) {
+    AVLNode<Key, Value>* curr = static_cast<AVLNode<Key, Value>*>(this->root_);
+    parent = nullptr;
     while (curr != nullptr) {
-        parent = curr;
-        if (k < curr->getKey()) curr = curr->getLeft();
-        else if (curr->getKey() < k) curr = curr->getRight();
-        else { // key exists
-            curr->setValue(v);
-#ifdef DEBUG
-std::cout << "end insert fn - LINE 280, KEY EXISTS - printing AVL in-order" << std::endl;
-this->debugPrint();
-#endif
-            return;
+        stats_.descend();
+        stats_.comparison();
+        if (k < curr->getKey()) {
+            parent = curr;
+            curr = curr->getLeft();
         }
+        else if (stats_.comparison(), curr->getKey() < k) {
+            parent = curr;
+            curr = curr->getRight();
+        }
+        else return curr;
     }
+    return nullptr;
+}
 
-    //at this point curr == nullptr so we are at a leaf 
+/**
+* Links the childless node n under parent (as the root if parent is null)
+* on the side its key belongs, then rebalances.
+*/
+template<class Key, class Value, class Stats, class Balance>
+void AVLTree<Key, Value, Stats, Balance>::linkNode(AVLNode<Key, Value>* parent, AVLNode<Key, Value>* n) {
+    n->setParent(parent);
+    if (parent == nullptr) {
+        this->root_ = n;
+        this->nodeCreated(n);
+        updatePath(n);
+        AVL_TRACE_EVENT(TRACE_INSERT, n->getKey(), n, 0, 0);
+        return;
+    }
 
-    AVLNode<Key, Value>* newNode = new AVLNode<Key, Value>(k, v, parent);
+    if (n->getKey() < parent->getKey()) parent->setLeft(n);
+    else parent->setRight(n);
+    this->nodeCreated(n);
+    // summaries first: the rotations below only regroup correct subtrees
+    updatePath(n);
+#if defined(DEBUG) || defined(AVL_TRACE)
+    int8_t parentBalanceBefore = parent->getBalance();
+#endif
 
-    if (k < parent->getKey()) parent->setLeft(newNode);
-    else parent->setRight(newNode);
+    Balance::afterInsert(*this, parent, n);
+    stats_.fixDone();
+    AVL_TRACE_EVENT(TRACE_INSERT, n->getKey(), n, parentBalanceBefore, parent->getBalance());
+}
 
-    // Initial update on parent's balance
-    // Determine the balance change (diff) at the parent
-    int8_t diff = (newNode == parent->getLeft() ? -1 : 1); // Note: diff is -1 for left, +1 for right
-    
-    // Case A: Parent's balance was 0
-    if (parent->getBalance() == 0) {
-        parent->updateBalance(diff);
-        // Height of parent's subtree increased, continue fix up.
-        insertFix(parent->getParent(), parent); // Propagate up
-    } 
-    // Case B: Parent's balance was -diff (now it's 0)
-    else if (parent->getBalance() == -diff) { 
-        // Parent's balance becomes 0. Height didn't change (it went from 1/0 to 1/1).
-        parent->setBalance(0);
-        // Stop propagation.
+/**
+* Moves every node of other into this tree; other is left empty. Nodes are
+* relinked, never allocated or copied. Keys present in both keep this
+* tree's value and other's node is freed.
+*
+* A source small enough that m descents beat a full pass (m log2(n + m) <
+* n + m) is attached node by node, with the usual rebalancing. Otherwise
+* both trees are flattened into one sorted array of node pointers and
+* rebuilt perfectly balanced in O(n + m), the tags coming from
+* Balance::fromHeights.
+*/
+template<class Key, class Value, class Stats, class Balance>
+void AVLTree<Key, Value, Stats, Balance>::merge(AVLTree&& other) {
+    if (&other == this || other.root_ == nullptr) return;
+
+    std::vector<AVLNode<Key, Value>*> theirs;
+    for (Node<Key, Value>* n = other.getSmallestNode(); n != nullptr; n = this->successor(n)) {
+        theirs.push_back(static_cast<AVLNode<Key, Value>*>(n));
     }
-    // Case C: Parent's balance was diff (now it becomes ±2)
-    else { // parent->getBalance() == diff 
-        // Unbalanced → parent's balance is now ±2. 
-        parent->updateBalance(diff); // Now parent is ±2 (e.g., -1 to -2)
-        // Call fix. insertFix must check if the grand's balance is already ±2 and skip the update.
-        insertFix(parent, newNode); 
+    // other gives up its nodes; its cache and filter describe them, so reset
+    other.root_ = nullptr;
+    other.size_ = 0;
+    if (other.cache_) other.cache_->reset();
+    if (other.filter_) other.filter_->reset();
+
+    const size_t m = theirs.size();
+    const size_t n = this->size();
+    size_t lg = 1;
+    while ((size_t(1) << lg) < n + m) ++lg;
+
+    if (m * lg < n + m) {
+        for (size_t i = 0; i < m; ++i) {
+            AVLNode<Key, Value>* x = theirs[i];
+            x->setLeft(nullptr);
+            x->setRight(nullptr);
+            x->setBalance(0);
+            AVLNode<Key, Value>* parent = nullptr;
+            if (findSlot(x->getKey(), parent) != nullptr) delete x;
+            else linkNode(parent, x);
+        }
+        return;
     }
 
-#ifdef DEBUG
-std::cout << "end insert fn - printing AVL in-order" << std::endl;
-this->debugPrint();
-#endif
+    std::vector<AVLNode<Key, Value>*> all;
+    all.reserve(n + m);
+    size_t j = 0;
+    for (Node<Key, Value>* x = this->getSmallestNode(); x != nullptr; x = this->successor(x)) {
+        AVLNode<Key, Value>* ours = static_cast<AVLNode<Key, Value>*>(x);
+        while (j < m && theirs[j]->getKey() < ours->getKey()) all.push_back(theirs[j++]);
+        if (j < m && !(ours->getKey() < theirs[j]->getKey())) { // duplicate
+            delete theirs[j];
+            theirs[j++] = nullptr;
+        }
+        all.push_back(ours);
+    }
+    while (j < m) all.push_back(theirs[j++]);
+
+    int height = 0;
+    this->root_ = buildBalanced(all, 0, all.size(), nullptr, height);
+    // this tree's own nodes were linked before; tell the hooks about the rest
+    for (size_t i = 0; i < m; ++i) {
+        if (theirs[i] != nullptr) this->nodeCreated(theirs[i]);
+    }
 }
 
+/**
+* Hangs nodes[lo, hi) as a perfectly balanced subtree under parent and
+* returns its root; height is set to the subtree's height (0 if empty).
+* Recursion depth is log2(hi - lo).
+*/
+template<class Key, class Value, class Stats, class Balance>
+AVLNode<Key, Value>* AVLTree<Key, Value, Stats, Balance>::buildBalanced(
+    const std::vector<AVLNode<Key, Value>*>& nodes, size_t lo, size_t hi, AVLNode<Key, Value>* parent, int& height) {
+    if (lo >= hi) {
+        height = 0;
+        return nullptr;
+    }
+    size_t mid = lo + (hi - lo) / 2;
+    AVLNode<Key, Value>* n = nodes[mid];
+    int lh = 0, rh = 0;
+    n->setParent(parent);
+    n->setLeft(buildBalanced(nodes, lo, mid, n, lh));
+    n->setRight(buildBalanced(nodes, mid + 1, hi, n, rh));
+    Balance::fromHeights(n, lh, rh);
+    if (augmented_) updateNode(n);
+    height = 1 + std::max(lh, rh);
+    return n;
+}
 
+/**
+* The Day-Stout-Warren rotations leave the tags stale. Two walks through
+* the parent pointers fix them without extra memory. The first, post-order,
+* stores every subtree's height in its root's tag slot. The second,
+* pre-order, turns each slot into the real tag while the node's children
+* still hold their heights.
+*/
+template<class Key, class Value, class Stats, class Balance>
+void AVLTree<Key, Value, Stats, Balance>::rebalance() {
+    BinarySearchTree<Key, Value>::rebalance();
+
+    for (int pass = 0; pass < 2; ++pass) {
+        AVLNode<Key, Value>* n = static_cast<AVLNode<Key, Value>*>(this->root_);
+        AVLNode<Key, Value>* prev = nullptr;
+        while (n != nullptr) {
+            AVLNode<Key, Value>* l = n->getLeft();
+            AVLNode<Key, Value>* r = n->getRight();
+            bool arrived = (prev == n->getParent());
+            if (arrived && pass == 1) {
+                Balance::fromHeights(n, heightTag(l), heightTag(r));
+            }
+            if (arrived && l != nullptr) { prev = n; n = l; continue; }
+            if (prev != r && r != nullptr) { prev = n; n = r; continue; }
+            // both subtrees done
+            if (pass == 0) {
+                n->setBalance(int8_t(1 + std::max(heightTag(l), heightTag(r))));
+                if (augmented_) updateNode(n);
+            }
+            prev = n;
+            n = n->getParent();
+        }
+    }
+}
 
 // --- REMOVE FIX ---
-template <class Key, class Value>
-void AVLTree<Key, Value>::removeFix(AVLNode<Key, Value>* n, int8_t diff) {
-#ifdef DEBUG
-std::cout << "start remove fix fn - printing AVL in-order" << std::endl;
-this->debugPrint();
-#endif
-
+template<class Key, class Value, class Stats, class Balance>
+void AVLTree<Key, Value, Stats, Balance>::removeFix(AVLNode<Key, Value>* n, int8_t diff) {
     while (n != nullptr) {
+        stats_.removeFixStep();
         n->updateBalance(diff);
+        AVL_TRACE_EVENT(TRACE_REMOVE_FIX, n->getKey(), n, n->getBalance() - diff, n->getBalance());
 
         int8_t b = n->getBalance();
         AVLNode<Key, Value>* parent = n->getParent();
@@ -388,6 +554,7 @@ this->debugPrint();
 
             if (leftChild->getBalance() <= 0) {
                 // Left-Left
+                stats_.singleRotation();
                 rotateRight(n);
                 if (leftChild->getBalance() == 0) {
                     n->setBalance(-1);
@@ -409,6 +576,7 @@ this->debugPrint();
                 AVLNode<Key, Value>* lr = leftChild->getRight();
                 // lr must exist if leftChild->getBalance() == 1
                 if (lr == nullptr) return;
+                stats_.doubleRotation();
 
                 rotateLeft(leftChild);
                 rotateRight(n);
@@ -440,6 +608,7 @@ this->debugPrint();
 
             if (rightChild->getBalance() >= 0) {
                 // Right-Right
+                stats_.singleRotation();
                 rotateLeft(n);
                 if (rightChild->getBalance() == 0) {
                     n->setBalance(1);
@@ -461,6 +630,7 @@ this->debugPrint();
                 AVLNode<Key, Value>* rl = rightChild->getLeft();
                 // rl must exist if rightChild->getBalance() == -1
                 if (rl == nullptr) return;
+                stats_.doubleRotation();
 
                 rotateRight(rightChild);
                 rotateLeft(n);
@@ -495,25 +665,19 @@ this->debugPrint();
             n = parent;
         }
     }
-#ifdef DEBUG
-std::cout << "end remove fix fn - printing AVL in-order" << std::endl;
-this->debugPrint();
-#endif
 }
 
 
 // Remove
-template<class Key, class Value>
-void AVLTree<Key, Value>::remove(const Key& key) {
-
-#ifdef DEBUG
-std::cout << "start remove fn - printing AVL in-order" << std::endl;
-this->debugPrint();
-#endif
-
-
-    AVLNode<Key, Value>* z = static_cast<AVLNode<Key, Value>*>(this->internalFind(key));
-    if (!z) return;
+template<class Key, class Value, class Stats, class Balance>
+void AVLTree<Key, Value, Stats, Balance>::remove(const Key& key) {
+    stats_.removeCall();
+    if (!this->mayContain(key)) return;
+    AVLNode<Key, Value>* z = findNode(key);
+    if (!z) {
+        if (this->filter_) this->filter_->falsePositive();
+        return;
+    }
 
     AVLNode<Key, Value>* parent = z->getParent();
     int8_t diff = 0; // Difference to apply to parent's balance
@@ -533,64 +697,62 @@ this->debugPrint();
     if (!parent) this->root_ = child;
     else if (parent->getLeft() == z) parent->setLeft(child);
     else parent->setRight(child);
+    updatePath(parent);
 
+#if defined(DEBUG) || defined(AVL_TRACE)
+    int8_t parentBalanceBefore = parent ? parent->getBalance() : 0;
+    const void* removed = z;
+#endif
+    this->nodeDestroyed(z);
     delete z;
-    removeFix(parent, diff);
-
+    Balance::afterRemove(*this, parent, child, diff);
+    stats_.fixDone();
+    AVL_TRACE_EVENT(TRACE_REMOVE, key, removed, parentBalanceBefore, parent ? parent->getBalance() : 0);
+}
 
-    #ifdef DEBUG
-std::cout << "end remove fn - printing AVL in-order" << std::endl;
-this->debugPrint();
-#endif
 
+// Same search as internalFind, but reports its work to the Stats policy
+template<class Key, class Value, class Stats, class Balance>
+AVLNode<Key, Value>* AVLTree<Key, Value, Stats, Balance>::findNode(const Key& key) {
+    AVLNode<Key, Value>* curr = static_cast<AVLNode<Key, Value>*>(this->root_);
+    while (curr != nullptr) {
+        stats_.descend();
+        stats_.comparison();
+        if (key < curr->getKey()) curr = curr->getLeft();
+        else if (stats_.comparison(), curr->getKey() < key) curr = curr->getRight();
+        else return curr;
+    }
+    return nullptr;
 }
 
 
-template<class Key, class Value>
-void AVLTree<Key, Value>::nodeSwap( AVLNode<Key,Value>* n1, AVLNode<Key,Value>* n2)
-{
+// Exported nodes (see bst_export.h) carry their balance
+template<class Key, class Value, class Stats, class Balance>
+bool AVLTree<Key, Value, Stats, Balance>::nodeBalance(const Node<Key, Value>* n, int& balance) const {
+    balance = static_cast<const AVLNode<Key, Value>*>(n)->getBalance();
+    return true;
+}
 
-#ifdef DEBUG
-std::cout << "start node swap fn - printing AVL in-order" << std::endl;
-this->debugPrint();
-#endif
 
+template<class Key, class Value, class Stats, class Balance>
+void AVLTree<Key, Value, Stats, Balance>::nodeSwap( AVLNode<Key,Value>* n1, AVLNode<Key,Value>* n2)
+{
     BinarySearchTree<Key, Value>::nodeSwap(n1, n2);
     int8_t tempB = n1->getBalance();
     n1->setBalance(n2->getBalance());
     n2->setBalance(tempB);
-
-#ifdef DEBUG
-std::cout << "end node swap fn - printing AVL in-order" << std::endl;
-this->debugPrint();
-#endif
+    // both walks: either node may be the deeper one
+    updatePath(n1);
+    updatePath(n2);
+    AVL_TRACE_EVENT(TRACE_NODE_SWAP, n1->getKey(), n1, tempB, n1->getBalance());
 }
 
 
-#ifdef DEBUG
-template<class Key, class Value>
-void AVLTree<Key, Value>::debugPrint() const {
-    std::cout << "AVL In-order: ";
-    printInOrderHelper(this->root_);
-    std::cout << std::endl;
-}
-
-
-template<class Key, class Value>
-void AVLTree<Key, Value>::printInOrderHelper(Node<Key,Value>* node) const {
-    if (!node) return;
-
-    auto* avn = static_cast<AVLNode<Key,Value>*>(node);
-
-    printInOrderHelper(node->getLeft());
-    std::cout << "(" 
-              << node->getKey()
-              << ", b=" << int(avn->getBalance())
-              << ") ";
-    printInOrderHelper(node->getRight());
-}
-
-#endif
+/**
+* An AVLTree rebalanced as a weak-AVL (rank-balanced) tree.
+*/
+template<class Key, class Value, class Stats = NoAVLStats>
+using WAVLTree = AVLTree<Key, Value, Stats, WAVLBalance>;
 
 
 #endif
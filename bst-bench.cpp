@@ -0,0 +1,1490 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <map>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "bst.h"
+#include "avlbst.h"
+#include "splaybst.h"
+#include "stringavlbst.h"
+#include "intervalbst.h"
+#include "augmentedbst.h"
+#include "mappedavlbst.h"
+#include "bst_latency.h"
+
+using namespace std;
+
+/*
+  Benchmark driver for BinarySearchTree, AVLTree and std::map.
+
+  Every (tree, workload) pair runs in its own forked process so that the
+  reported peak RSS belongs to that tree alone. Rows are printed as a
+  table, CSV or JSON; CSV/JSON output is stable so two runs can be diffed.
+
+  usage: bst-bench [--n N] [--reps R] [--trees bst,avl,map]
+                   [--workloads uniform,sequential,zipf,zipf-drift,delete-heavy,
+                                urls,paths,intervals]
+                   [--batch 1,4,16,64] [--sorted] [--upsert] [--merge] [--aggregate]
+                   [--rebalance] [--export]
+                   [--format table|csv|json] [--out FILE]
+
+  Phases: insert, find, iterate, copy (copy construction plus destruction
+  of the copy), remove and mixed.
+  --batch adds one find_batch_<L> phase per lane count L (a power of two up
+  to 64): the find phase's probes answered by find_batch<L>() in chunks of
+  256 keys. std::map has no batched lookup and loops over find().
+  --sorted adds find_sorted_loop (find() over the probes in ascending
+  order) and find_sorted (the same keys through find_sorted()).
+  --upsert adds two counter phases over the probe keys: count_3pass
+  (find, insert if missing, then operator[]++) and count_upsert (one
+  upsert() per key; std::map's operator[] for map).
+  --merge splits the build keys into two trees and times combining them:
+  merge_1_64 / merge_1_2 move a source of n/64 / n/2 keys with
+  AVLTree::merge (node-by-node insertion elsewhere), reinsert_1_2 inserts
+  the n/2 source into the destination element by element and frees it.
+  --aggregate adds range_sum: the sum of the values over key ranges
+  [lo, hi) between two random build keys (a third of the tree on average),
+  n / 100 of them (at most 1000). avl-sum answers with aggregate(), map
+  with lower_bound() and a walk; trees without either skip the phase.
+  --rebalance adds rebalance, one in-place Day-Stout-Warren rebalance()
+  of the built tree (ops = n), and find_rebalanced, the find phase's
+  probes against the rebalanced tree (its rebalance() is not timed). bst
+  on sequential keys shows the gain most; map has no rebalance() and
+  skips both.
+  --export adds export_dot and export_json: exportTree() of the whole tree
+  into a string stream as Graphviz DOT / JSON. map has no exporter and
+  skips them.
+
+  Trees: bst, avl, wavl (AVLTree with WAVLBalance), splay, semisplay
+  (SplayTree in SEMI_SPLAY mode), avl-cache (lookup cache of 1024 sets,
+  hit rate in the extra column), avl-filter (membership filter sized for n,
+  false-positive rate in the extra column), map, and avl-stats /
+  wavl-stats, which count rotations and fix-up steps per timed operation
+  in the extra column (compare their throughput with avl / wavl, not map).
+  avl-sum is an AugmentedAVLTree with SumMonoid<long>: the other phases
+  show what keeping the summaries costs.
+  bst-sg is a BinarySearchTree with the scapegoat policy at the default
+  alpha; the extra column gives rebuilds and rebuilt nodes per timed
+  operation. Compare it with bst on the sequential workload.
+  avl-timed wraps an AVLTree in TimedTree (bst_latency.h) and times every
+  insert, find, remove and operator[]: the extra column gives the phase's
+  p50 / p99 / p999 / max latency, and the throughput next to avl's shows
+  the cost of the clock reads.
+  mapped is a MappedAVLTree<int, int> in a /dev/shm file and runs only
+  insert, find, open and remove. open is the startup cost of another
+  process: mapping the built tree as a reader and doing one lookup (ops =
+  1), where the other trees would rebuild (their insert row). The file
+  size is in the extra column.
+
+  The urls and paths workloads use string keys and run only avl
+  (AVLTree<std::string, int>), string-avl (StringAVLTree) and map, with
+  the phases insert, find, prefix (prefix scans; ops counts keys visited
+  plus scans, avl has none) and remove. node_bytes in the extra column is
+  the node size; the key's heap buffer, if any, comes on top.
+
+  The intervals workload stores n intervals [lo, hi] (mostly short, 1% of
+  them long) and runs only interval (IntervalTree), avl
+  (AVLTree<Interval<int>, int>) and map, with the phases insert, stab
+  (intervals containing a point), overlap (intervals overlapping a short
+  range) and remove. avl and map answer queries with an in-order scan up to
+  the query's end; both query phases time n / 100 queries (at most 1000),
+  and the extra column gives the average number of intervals reported per
+  query.
+*/
+
+//one line of output
+struct BenchResult
+{
+    string tree;
+    string workload;
+    string op;
+    size_t n;          //tree size the op ran against
+    size_t ops;        //number of operations timed
+    double seconds;    //best of --reps runs
+    long peakRssKb;    //process high-water mark after the op
+    string extra;      //free-form key=value;... metrics
+};
+
+struct BenchConfig
+{
+    size_t n;
+    int reps;
+    size_t degenerateCap; //max n for the unbalanced BST on sequential keys
+    vector<string> trees;
+    vector<string> workloads;
+    vector<size_t> batchLanes; //find_batch lane counts to measure
+    bool sortedPhases;         //add the find_sorted phases
+    bool upsertPhases;         //add the counter phases
+    bool mergePhases;          //add the merge phases
+    bool aggregatePhases;      //add the range_sum phase
+    bool rebalancePhases;      //add the rebalance phases
+    bool exportPhases;         //add the export phases
+    string format;
+    string out;
+};
+
+/*
+  ----------------------------------------
+  Workload generation
+  ----------------------------------------
+*/
+
+//a workload is a key sequence to build the tree with, a key sequence to
+//probe it with, and the op mix used by the "mixed" phase
+struct Workload
+{
+    string name;
+    vector<int> build;
+    vector<int> probe;
+    vector<int> removeOrder;
+    vector<uint8_t> mixOps; //0 = find, 1 = insert, 2 = remove
+    vector<int> mixKeys;
+};
+
+//scatters ranks over the key space so hot keys are not neighbours
+static int scramble(uint32_t rank)
+{
+    return static_cast<int>(rank * 2654435761u);
+}
+
+/**
+ * Draws ranks in [0, n) with P(rank = i) proportional to 1 / (i+1)^s.
+ */
+class ZipfGenerator
+{
+public:
+    ZipfGenerator(size_t n, double s) : cdf_(n)
+    {
+        double sum = 0;
+        for (size_t i = 0; i < n; ++i) {
+            sum += 1.0 / std::pow(double(i + 1), s);
+            cdf_[i] = sum;
+        }
+        for (size_t i = 0; i < n; ++i) cdf_[i] /= sum;
+    }
+
+    template<class Rng>
+    uint32_t operator()(Rng& rng)
+    {
+        double u = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+        return static_cast<uint32_t>(std::lower_bound(cdf_.begin(), cdf_.end(), u) - cdf_.begin());
+    }
+
+private:
+    vector<double> cdf_;
+};
+
+static void fillMix(Workload& w, mt19937& rng, size_t count, int findPct, int insertPct,
+                    const vector<int>& keySpace)
+{
+    w.mixOps.resize(count);
+    w.mixKeys.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        int r = rng() % 100;
+        w.mixOps[i] = (r < findPct) ? 0 : (r < findPct + insertPct ? 1 : 2);
+        w.mixKeys[i] = keySpace[rng() % keySpace.size()];
+    }
+}
+
+static Workload makeWorkload(const string& name, size_t n)
+{
+    Workload w;
+    w.name = name;
+    mt19937 rng(12345);
+
+    if (name == "sequential") {
+        for (size_t i = 0; i < n; ++i) w.build.push_back(int(i));
+        w.probe = w.build;
+        w.removeOrder = w.build;
+        fillMix(w, rng, n, 50, 25, w.build);
+    }
+    else if (name == "zipf") {
+        ZipfGenerator zipf(n, 0.99);
+        for (size_t i = 0; i < n; ++i) w.build.push_back(scramble(zipf(rng)));
+        for (size_t i = 0; i < n; ++i) w.probe.push_back(scramble(zipf(rng)));
+        w.removeOrder = w.build;
+        fillMix(w, rng, n, 50, 25, w.probe);
+    }
+    else if (name == "zipf-drift") {
+        //every key present; Zipf probes whose hot set moves to a new part
+        //of the key space every n/8 probes
+        for (size_t i = 0; i < n; ++i) w.build.push_back(scramble(uint32_t(i)));
+        std::shuffle(w.build.begin(), w.build.end(), rng);
+        ZipfGenerator zipf(n, 0.99);
+        size_t window = std::max<size_t>(1, n / 8);
+        for (size_t i = 0; i < n; ++i) {
+            size_t shift = (i / window) * (n / 8 + 7919);
+            w.probe.push_back(scramble(uint32_t((zipf(rng) + shift) % n)));
+        }
+        w.removeOrder = w.build;
+        fillMix(w, rng, n, 90, 5, w.probe);
+    }
+    else if (name == "delete-heavy") {
+        for (size_t i = 0; i < n; ++i) w.build.push_back(scramble(uint32_t(rng() % (4 * n))));
+        w.probe = w.build;
+        std::shuffle(w.probe.begin(), w.probe.end(), rng);
+        w.removeOrder = w.probe;
+        fillMix(w, rng, n, 20, 20, w.build);
+    }
+    else { // uniform
+        for (size_t i = 0; i < n; ++i) w.build.push_back(scramble(uint32_t(rng() % (4 * n))));
+        for (size_t i = 0; i < n; ++i) w.probe.push_back(scramble(uint32_t(rng() % (4 * n))));
+        w.removeOrder = w.build;
+        std::shuffle(w.removeOrder.begin(), w.removeOrder.end(), rng);
+        fillMix(w, rng, n, 50, 25, w.build);
+    }
+    return w;
+}
+
+//string-keyed workloads: URL- or path-like keys sharing long heads
+struct StringWorkload
+{
+    string name;
+    vector<string> build;
+    vector<string> probe;    //half present, half near misses
+    vector<string> prefixes; //prefix_range queries, cut at a '/'
+};
+
+static bool isStringWorkload(const string& name)
+{
+    return name == "urls" || name == "paths";
+}
+
+static StringWorkload makeStringWorkload(const string& name, size_t n)
+{
+    StringWorkload w;
+    w.name = name;
+    mt19937 rng(12345);
+    const char* words[] = { "api", "docs", "user", "img", "static", "v2", "search", "blog",
+                            "src", "include", "lib", "test", "build", "assets", "config", "data" };
+    const size_t nWords = sizeof(words) / sizeof(words[0]);
+
+    for (size_t i = 0; i < n; ++i) {
+        ostringstream os;
+        if (name == "urls") {
+            os << "https://www." << (rng() % 2 ? "shop" : "news") << rng() % 300 << ".com";
+            int depth = 1 + rng() % 4;
+            for (int d = 0; d < depth; ++d) os << '/' << words[rng() % nWords];
+            os << "/item" << rng() % 100000;
+            if (rng() % 3 == 0) os << "?id=" << rng() % 1000000;
+        }
+        else {
+            os << "/home/user" << rng() % 50 << "/projects";
+            int depth = 2 + rng() % 5;
+            for (int d = 0; d < depth; ++d) os << '/' << words[rng() % nWords];
+            os << "/file" << rng() % 100000 << ".cpp";
+        }
+        w.build.push_back(os.str());
+    }
+    for (size_t i = 0; i < n; ++i) {
+        string k = w.build[rng() % n];
+        if (rng() % 2) k[k.size() - 1 - rng() % 4] ^= 1;
+        w.probe.push_back(k);
+    }
+    for (size_t i = 0; i < std::max<size_t>(1, n / 16); ++i) {
+        const string& k = w.build[rng() % n];
+        size_t cut = k.rfind('/');
+        if (cut > 0 && rng() % 2) cut = k.rfind('/', cut - 1);
+        w.prefixes.push_back(k.substr(0, cut + 1));
+    }
+    return w;
+}
+
+//interval workload: time-interval-like spans and point / range queries
+struct IntervalWorkload
+{
+    string name;
+    vector<Interval<int> > build;
+    vector<Interval<int> > queries; //stab uses lo, overlap the whole range
+};
+
+static bool isIntervalWorkload(const string& name)
+{
+    return name == "intervals";
+}
+
+static IntervalWorkload makeIntervalWorkload(const string& name, size_t n)
+{
+    IntervalWorkload w;
+    w.name = name;
+    mt19937 rng(12345);
+    const int span = int(std::min<size_t>(n * 10, 1u << 30));
+    for (size_t i = 0; i < n; ++i) {
+        int lo = int(rng() % span);
+        int len = (rng() % 100 == 0) ? int(rng() % (span / 10 + 1)) : int(rng() % 64);
+        w.build.push_back(makeInterval(lo, lo + len));
+    }
+    //the scans are O(n) per query, so keep their phases short
+    for (size_t i = 0; i < std::min<size_t>(std::max<size_t>(1, n / 100), 1000); ++i) {
+        int a = int(rng() % span);
+        w.queries.push_back(makeInterval(a, a + int(rng() % 640)));
+    }
+    return w;
+}
+
+/*
+  ----------------------------------------
+  Tree adapters
+  ----------------------------------------
+*/
+
+//merge phases: AVLTree::merge where the tree has it, reinsertion elsewhere
+template<class K, class V, class S, class B>
+static void mergeInto(AVLTree<K, V, S, B>& dst, AVLTree<K, V, S, B>& src)
+{
+    dst.merge(std::move(src));
+}
+
+template<class Tree>
+static void mergeInto(Tree& dst, Tree& src)
+{
+    for (typename Tree::iterator it = src.begin(); it != src.end(); ++it) dst.insert(*it);
+    src.clear();
+}
+
+//keys per find_batch call in the find_batch_<L> phases
+static const size_t BATCH_CHUNK = 256;
+
+template<class Tree>
+struct TreeAdapter
+{
+    Tree t;
+    void insert(int k, int v) { t.insert(std::make_pair(k, v)); }
+    bool find(int k) const { return t.find(k) != t.end(); }
+    void remove(int k) { t.remove(k); }
+    void count3Pass(int k)
+    {
+        if (t.find(k) == t.end()) t.insert(std::make_pair(k, 0));
+        ++t[k];
+    }
+    void countUpsert(int k) { t.upsert(k, [](int& v) { ++v; }); }
+    void mergeFrom(TreeAdapter& src) { mergeInto(t, src.t); }
+    void reinsertFrom(TreeAdapter& src)
+    {
+        for (typename Tree::iterator it = src.t.begin(); it != src.t.end(); ++it) t.insert(*it);
+        src.t.clear();
+    }
+    //copy construction and destruction of the copy
+    long copy() const
+    {
+        Tree c(t);
+        return c.empty() ? 0 : 1;
+    }
+    long iterate() const
+    {
+        long sum = 0;
+        for (typename Tree::iterator it = t.begin(); it != t.end(); ++it) sum += it->second;
+        return sum;
+    }
+    long findBatch(const vector<int>& keys, size_t lanes) const
+    {
+        switch (lanes) {
+        case 1: return findBatchWith<1>(keys);
+        case 2: return findBatchWith<2>(keys);
+        case 4: return findBatchWith<4>(keys);
+        case 8: return findBatchWith<8>(keys);
+        case 16: return findBatchWith<16>(keys);
+        case 32: return findBatchWith<32>(keys);
+        default: return findBatchWith<64>(keys);
+        }
+    }
+    template<size_t Lanes>
+    long findBatchWith(const vector<int>& keys) const
+    {
+        typename Tree::iterator out[BATCH_CHUNK];
+        long sum = 0;
+        for (size_t i = 0; i < keys.size(); i += BATCH_CHUNK) {
+            size_t m = std::min(BATCH_CHUNK, keys.size() - i);
+            t.template find_batch<Lanes>(keys.begin() + i, keys.begin() + i + m, out);
+            for (size_t j = 0; j < m; ++j) sum += (out[j] != t.end());
+        }
+        return sum;
+    }
+    long findSorted(const vector<int>& keys) const
+    {
+        typename Tree::iterator out[BATCH_CHUNK];
+        long sum = 0;
+        for (size_t i = 0; i < keys.size(); i += BATCH_CHUNK) {
+            size_t m = std::min(BATCH_CHUNK, keys.size() - i);
+            t.find_sorted(keys.begin() + i, keys.begin() + i + m, out);
+            for (size_t j = 0; j < m; ++j) sum += (out[j] != t.end());
+        }
+        return sum;
+    }
+    //sum of the values with keys in [lo, hi); false if the tree cannot
+    //do better than a full scan
+    bool rangeSum(int, int, long&) const { return false; }
+    //reshape into a balanced tree in place; false if there is no such step
+    bool rebalance()
+    {
+        t.rebalance();
+        return true;
+    }
+    //exportTree() into os; false if the tree has no exporter
+    bool exportTo(std::ostream& os, const TreeExportOptions& opts) const
+    {
+        t.exportTree(os, opts);
+        return true;
+    }
+    void mark() {}
+    string extra(size_t) const { return ""; }
+};
+
+//expected key count for FilterAdapter, set per case
+static size_t benchFilterKeys = 1024;
+
+//SplayTree: lookups go through the splaying (non-const) find
+template<class Tree>
+struct SplayAdapter : TreeAdapter<Tree>
+{
+    explicit SplayAdapter(SplayMode mode = FULL_SPLAY) { this->t.setMode(mode); }
+    bool find(int k) { return this->t.find(k) != this->t.end(); }
+};
+
+struct SemiSplayAdapter : SplayAdapter<SplayTree<int, int> >
+{
+    SemiSplayAdapter() : SplayAdapter<SplayTree<int, int> >(SEMI_SPLAY) {}
+};
+
+//lookup cache enabled: reports its hit rate for the timed phase
+template<class Tree>
+struct CacheAdapter : TreeAdapter<Tree>
+{
+    CacheAdapter() { this->t.enableLookupCache(1024); }
+    void mark() { this->t.resetLookupCacheStats(); }
+    string extra(size_t) const
+    {
+        LookupCacheStats s = this->t.lookupCacheStats();
+        ostringstream os;
+        os << std::fixed << std::setprecision(3) << "cache_hit_rate=" << s.hitRate()
+           << ";cache_bytes=" << s.bytes;
+        return os.str();
+    }
+};
+
+//membership filter sized for the workload: reports its false-positive rate
+template<class Tree>
+struct FilterAdapter : TreeAdapter<Tree>
+{
+    FilterAdapter() { this->t.enableMembershipFilter(benchFilterKeys); }
+    void mark() { this->t.resetMembershipFilterStats(); }
+    string extra(size_t) const
+    {
+        MembershipFilterStats s = this->t.membershipFilterStats();
+        ostringstream os;
+        os << std::fixed << std::setprecision(4) << "filter_rejected=" << s.rejected
+           << ";filter_fp_rate=" << s.falsePositiveRate() << ";filter_bytes=" << s.bytes;
+        return os.str();
+    }
+};
+
+//unbalanced tree with the scapegoat policy: reports the rebuild work of
+//the timed phase
+template<class Tree>
+struct ScapegoatAdapter : TreeAdapter<Tree>
+{
+    ScapegoatAdapter() { this->t.enableScapegoat(); }
+    void mark() { this->t.resetScapegoatStats(); }
+    string extra(size_t ops) const
+    {
+        ScapegoatStats s = this->t.scapegoatStats();
+        double per = ops ? 1.0 / double(ops) : 0.0;
+        ostringstream os;
+        os << std::fixed << std::setprecision(3)
+           << "rebuilds_per_op=" << double(s.rebuilds + s.fullRebuilds) * per
+           << ";nodes_rebuilt_per_op=" << double(s.nodesRebuilt) * per;
+        return os.str();
+    }
+};
+
+//AVLTree with AVLStats: reports the rebalancing work of the timed phase
+template<class Tree>
+struct StatsAdapter : TreeAdapter<Tree>
+{
+    void mark() { this->t.resetStats(); }
+    string extra(size_t ops) const
+    {
+        const AVLStats& s = this->t.stats();
+        double per = ops ? 1.0 / double(ops) : 0.0;
+        ostringstream os;
+        os << std::fixed << std::setprecision(3)
+           << "rotations_per_op=" << double(s.rotateLefts + s.rotateRights) * per
+           << ";fix_steps_per_op=" << double(s.insertFixSteps + s.removeFixSteps) * per;
+        return os.str();
+    }
+};
+
+//summaries of the values: O(log n) range sums
+struct SumAdapter : TreeAdapter<AugmentedAVLTree<int, int, SumMonoid<long> > >
+{
+    //operator[] is read-only on this tree
+    void count3Pass(int k)
+    {
+        if (t.find(k) == t.end()) t.insert(std::make_pair(k, 0));
+        t.insert(std::make_pair(k, t[k] + 1));
+    }
+    void mergeFrom(SumAdapter& src) { t.merge(std::move(src.t)); }
+    bool rangeSum(int lo, int hi, long& sum) const
+    {
+        sum = t.aggregate(lo, hi);
+        return true;
+    }
+};
+
+//AVLTree behind TimedTree: every insert, find, remove and operator[] is
+//timed; the extra column has the latency percentiles of the timed phase
+struct TimedAdapter
+{
+    typedef AVLTree<int, int> Tree;
+    TimedTree<Tree> t;
+    void insert(int k, int v) { t.insert(std::make_pair(k, v)); }
+    bool find(int k) const { return t.find(k) != t.end(); }
+    void remove(int k) { t.remove(k); }
+    void count3Pass(int k)
+    {
+        if (t.find(k) == t.end()) t.insert(std::make_pair(k, 0));
+        ++t[k];
+    }
+    void countUpsert(int k) { t.tree().upsert(k, [](int& v) { ++v; }); }
+    void mergeFrom(TimedAdapter& src) { mergeInto(t.tree(), src.t.tree()); }
+    void reinsertFrom(TimedAdapter& src)
+    {
+        for (Tree::iterator it = src.t.begin(); it != src.t.end(); ++it) t.insert(*it);
+        src.t.tree().clear();
+    }
+    long copy() const
+    {
+        Tree c(t.tree());
+        return c.empty() ? 0 : 1;
+    }
+    long iterate() const
+    {
+        long sum = 0;
+        for (Tree::iterator it = t.begin(); it != t.end(); ++it) sum += it->second;
+        return sum;
+    }
+    long findBatch(const vector<int>& keys, size_t) const
+    {
+        long sum = 0;
+        for (size_t i = 0; i < keys.size(); ++i) sum += find(keys[i]);
+        return sum;
+    }
+    long findSorted(const vector<int>& keys) const { return findBatch(keys, 1); }
+    bool rangeSum(int, int, long&) const { return false; }
+    bool rebalance()
+    {
+        t.tree().rebalance();
+        return true;
+    }
+    bool exportTo(std::ostream& os, const TreeExportOptions& opts) const
+    {
+        t.tree().exportTree(os, opts);
+        return true;
+    }
+    void mark() { t.resetLatency(); }
+    string extra(size_t) const
+    {
+        LatencyHistogram h;
+        for (int op = 0; op < TimedTree<Tree>::OP_COUNT; ++op) {
+            h.merge(t.latency(TimedTree<Tree>::Op(op)));
+        }
+        if (h.count() == 0) return "";
+        ostringstream os;
+        os << "p50_ns=" << h.percentile(0.5) << ";p99_ns=" << h.percentile(0.99)
+           << ";p999_ns=" << h.percentile(0.999) << ";max_ns=" << h.max();
+        return os.str();
+    }
+};
+
+struct MapAdapter
+{
+    std::map<int, int> t;
+    void insert(int k, int v) { t[k] = v; }
+    bool find(int k) const { return t.find(k) != t.end(); }
+    void remove(int k) { t.erase(k); }
+    void count3Pass(int k)
+    {
+        if (t.find(k) == t.end()) t.insert(std::make_pair(k, 0));
+        ++t[k];
+    }
+    void countUpsert(int k) { ++t[k]; }
+    void mergeFrom(MapAdapter& src) { reinsertFrom(src); }
+    void reinsertFrom(MapAdapter& src)
+    {
+        t.insert(src.t.begin(), src.t.end());
+        src.t.clear();
+    }
+    long copy() const
+    {
+        std::map<int, int> c(t);
+        return c.empty() ? 0 : 1;
+    }
+    long iterate() const
+    {
+        long sum = 0;
+        for (std::map<int, int>::const_iterator it = t.begin(); it != t.end(); ++it) sum += it->second;
+        return sum;
+    }
+    long findBatch(const vector<int>& keys, size_t) const
+    {
+        long sum = 0;
+        for (size_t i = 0; i < keys.size(); ++i) sum += find(keys[i]);
+        return sum;
+    }
+    long findSorted(const vector<int>& keys) const { return findBatch(keys, 1); }
+    bool rangeSum(int lo, int hi, long& sum) const
+    {
+        sum = 0;
+        for (std::map<int, int>::const_iterator it = t.lower_bound(lo); it != t.end() && it->first < hi; ++it) {
+            sum += it->second;
+        }
+        return true;
+    }
+    //red-black: always balanced
+    bool rebalance() { return false; }
+    bool exportTo(std::ostream&, const TreeExportOptions&) const { return false; }
+    void mark() {}
+    string extra(size_t) const { return ""; }
+};
+
+template<class Tree>
+struct StringTreeAdapter
+{
+    Tree t;
+    void insert(const string& k, int v) { t.insert(std::make_pair(k, v)); }
+    bool find(const string& k) const { return t.find(k) != t.end(); }
+    void remove(const string& k) { t.remove(k); }
+    //keys under the prefix, or -1 if the tree has no prefix scan
+    long prefixCount(const string&) const { return -1; }
+    string extra() const
+    {
+        ostringstream os;
+        os << "node_bytes=" << sizeof(AVLNode<string, int>);
+        return os.str();
+    }
+};
+
+struct StringAVLAdapter : StringTreeAdapter<StringAVLTree<int> >
+{
+    long prefixCount(const string& prefix) const
+    {
+        std::pair<StringAVLTree<int>::iterator, StringAVLTree<int>::iterator> r = t.prefix_range(prefix);
+        long count = 0;
+        for (StringAVLTree<int>::iterator it = r.first; it != r.second; ++it) ++count;
+        return count;
+    }
+    string extra() const
+    {
+        ostringstream os;
+        os << "node_bytes=" << sizeof(StringAVLNode<int>) << ";common_prefix=" << t.commonPrefixLength();
+        return os.str();
+    }
+};
+
+struct StringMapAdapter
+{
+    std::map<string, int> t;
+    void insert(const string& k, int v) { t[k] = v; }
+    bool find(const string& k) const { return t.find(k) != t.end(); }
+    void remove(const string& k) { t.erase(k); }
+    long prefixCount(const string& prefix) const
+    {
+        long count = 0;
+        for (std::map<string, int>::const_iterator it = t.lower_bound(prefix);
+             it != t.end() && it->first.compare(0, prefix.size(), prefix) == 0; ++it) ++count;
+        return count;
+    }
+    string extra() const { return ""; }
+};
+
+struct IntervalTreeAdapter
+{
+    IntervalTree<int, int> t;
+    void insert(const Interval<int>& k, int v) { t.insert(std::make_pair(k, v)); }
+    void remove(const Interval<int>& k) { t.remove(k); }
+    size_t overlapping(int a, int b) const
+    {
+        size_t count = 0;
+        CountingOutput out(count);
+        t.overlapping(a, b, out);
+        return count;
+    }
+
+    //counts what the query writes instead of storing it
+    struct CountingOutput
+    {
+        size_t* count;
+        explicit CountingOutput(size_t& c) : count(&c) {}
+        CountingOutput& operator*() { return *this; }
+        CountingOutput& operator++(int) { return *this; }
+        template<class It> CountingOutput& operator=(const It&) { ++*count; return *this; }
+    };
+};
+
+//the linear scan an unaugmented ordered container is left with
+template<class Tree>
+struct IntervalScanAdapter
+{
+    Tree t;
+    void insert(const Interval<int>& k, int v) { t.insert(std::make_pair(k, v)); }
+    void remove(const Interval<int>& k) { eraseKey(t, k); }
+    size_t overlapping(int a, int b)
+    {
+        size_t count = 0;
+        for (typename Tree::iterator it = t.begin(); it != t.end() && !(b < it->first.lo); ++it) {
+            count += !(it->first.hi < a);
+        }
+        return count;
+    }
+    template<class T> static void eraseKey(T& tree, const Interval<int>& k) { tree.remove(k); }
+    static void eraseKey(std::map<Interval<int>, int>& tree, const Interval<int>& k) { tree.erase(k); }
+};
+
+/*
+  ----------------------------------------
+  Measurement
+  ----------------------------------------
+*/
+
+static volatile long benchSink;
+
+static long peakRssKb()
+{
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_maxrss;
+}
+
+static double now()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+template<class Adapter>
+static void build(Adapter& a, const Workload& w, size_t n)
+{
+    for (size_t i = 0; i < n; ++i) a.insert(w.build[i], int(i));
+}
+
+/**
+ * Runs every phase of one workload against one tree type, appending one
+ * row per phase. Each repetition starts from a freshly built tree.
+ */
+template<class Adapter>
+static void runWorkload(const string& treeName, const Workload& w, size_t n,
+                        const BenchConfig& cfg, vector<BenchResult>& rows)
+{
+    vector<string> phases;
+    phases.push_back("insert");
+    phases.push_back("find");
+    for (size_t b = 0; b < cfg.batchLanes.size(); ++b) {
+        phases.push_back("find_batch_" + std::to_string(cfg.batchLanes[b]));
+    }
+    vector<int> sortedProbe;
+    if (cfg.sortedPhases) {
+        phases.push_back("find_sorted_loop");
+        phases.push_back("find_sorted");
+        sortedProbe = w.probe;
+        std::sort(sortedProbe.begin(), sortedProbe.end());
+    }
+    if (cfg.upsertPhases) {
+        phases.push_back("count_3pass");
+        phases.push_back("count_upsert");
+    }
+    if (cfg.mergePhases) {
+        phases.push_back("merge_1_64");
+        phases.push_back("merge_1_2");
+        phases.push_back("reinsert_1_2");
+    }
+    vector<std::pair<int, int> > ranges;
+    if (cfg.aggregatePhases) {
+        phases.push_back("range_sum");
+        mt19937 rng(777);
+        for (size_t i = 0; i < std::min<size_t>(std::max<size_t>(1, n / 100), 1000); ++i) {
+            int a = w.build[rng() % n], b = w.build[rng() % n];
+            ranges.push_back(std::make_pair(std::min(a, b), std::max(a, b)));
+        }
+    }
+    if (cfg.rebalancePhases) {
+        phases.push_back("rebalance");
+        phases.push_back("find_rebalanced");
+    }
+    if (cfg.exportPhases) {
+        phases.push_back("export_dot");
+        phases.push_back("export_json");
+    }
+    phases.push_back("iterate");
+    phases.push_back("copy");
+    phases.push_back("remove");
+    phases.push_back("mixed");
+    for (size_t p = 0; p < phases.size(); ++p) {
+        string op = phases[p];
+        size_t lanes = (op.compare(0, 11, "find_batch_") == 0) ? std::strtoul(op.c_str() + 11, NULL, 10) : 0;
+        double best = 1e300;
+        size_t ops = 0;
+        size_t size = 0;
+        string extra;
+        bool supported = true;
+        for (int rep = 0; rep < cfg.reps && supported; ++rep) {
+            Adapter* a = new Adapter;
+            double t0 = 0, t1 = 0;
+            long sum = 0;
+            if (op == "insert") {
+                a->mark();
+                t0 = now();
+                build(*a, w, n);
+                t1 = now();
+                ops = n;
+            }
+            else if (op.compare(0, 6, "merge_") == 0 || op == "reinsert_1_2") {
+                size_t part = (op == "merge_1_64") ? n / 64 : n / 2;
+                Adapter* src = new Adapter;
+                for (size_t i = 0; i < n - part; ++i) a->insert(w.build[i], int(i));
+                for (size_t i = n - part; i < n; ++i) src->insert(w.build[i], int(i));
+                a->mark();
+                t0 = now();
+                if (op == "reinsert_1_2") a->reinsertFrom(*src);
+                else a->mergeFrom(*src);
+                t1 = now();
+                ops = part;
+                delete src;
+            }
+            else {
+                build(*a, w, n);
+                a->mark();
+                if (op == "find") {
+                    t0 = now();
+                    for (size_t i = 0; i < n; ++i) sum += a->find(w.probe[i]);
+                    t1 = now();
+                    ops = n;
+                }
+                else if (op == "find_sorted_loop") {
+                    t0 = now();
+                    for (size_t i = 0; i < n; ++i) sum += a->find(sortedProbe[i]);
+                    t1 = now();
+                    ops = n;
+                }
+                else if (op == "find_sorted") {
+                    t0 = now();
+                    sum += a->findSorted(sortedProbe);
+                    t1 = now();
+                    ops = n;
+                }
+                else if (op == "count_3pass") {
+                    t0 = now();
+                    for (size_t i = 0; i < n; ++i) a->count3Pass(w.probe[i]);
+                    t1 = now();
+                    ops = n;
+                }
+                else if (op == "count_upsert") {
+                    t0 = now();
+                    for (size_t i = 0; i < n; ++i) a->countUpsert(w.probe[i]);
+                    t1 = now();
+                    ops = n;
+                }
+                else if (op == "range_sum") {
+                    t0 = now();
+                    for (size_t i = 0; i < ranges.size() && supported; ++i) {
+                        long s = 0;
+                        supported = a->rangeSum(ranges[i].first, ranges[i].second, s);
+                        sum += s;
+                    }
+                    t1 = now();
+                    ops = ranges.size();
+                }
+                else if (op == "export_dot" || op == "export_json") {
+                    TreeExportOptions opts;
+                    if (op == "export_json") opts.format = TreeExportOptions::JSON;
+                    ostringstream os;
+                    t0 = now();
+                    supported = a->exportTo(os, opts);
+                    t1 = now();
+                    sum += long(os.tellp());
+                    ops = n;
+                }
+                else if (op == "rebalance") {
+                    t0 = now();
+                    supported = a->rebalance();
+                    t1 = now();
+                    ops = n;
+                }
+                else if (op == "find_rebalanced") {
+                    supported = a->rebalance();
+                    a->mark();
+                    t0 = now();
+                    for (size_t i = 0; i < n && supported; ++i) sum += a->find(w.probe[i]);
+                    t1 = now();
+                    ops = n;
+                }
+                else if (lanes > 0) {
+                    t0 = now();
+                    sum += a->findBatch(w.probe, lanes);
+                    t1 = now();
+                    ops = n;
+                }
+                else if (op == "iterate") {
+                    t0 = now();
+                    sum += a->iterate();
+                    t1 = now();
+                    ops = n;
+                }
+                else if (op == "copy") {
+                    t0 = now();
+                    sum += a->copy();
+                    t1 = now();
+                    ops = n;
+                }
+                else if (op == "remove") {
+                    t0 = now();
+                    for (size_t i = 0; i < n; ++i) a->remove(w.removeOrder[i]);
+                    t1 = now();
+                    ops = n;
+                }
+                else {
+                    size_t count = std::min(n, w.mixOps.size());
+                    t0 = now();
+                    for (size_t i = 0; i < count; ++i) {
+                        int k = w.mixKeys[i];
+                        if (w.mixOps[i] == 0) sum += a->find(k);
+                        else if (w.mixOps[i] == 1) a->insert(k, int(i));
+                        else a->remove(k);
+                    }
+                    t1 = now();
+                    ops = count;
+                }
+            }
+            size = n;
+            benchSink = sum;
+            best = std::min(best, t1 - t0);
+            extra = a->extra(ops);
+            delete a;
+        }
+        if (!supported) continue;
+
+        BenchResult r;
+        r.tree = treeName;
+        r.workload = w.name;
+        r.op = op;
+        r.n = size;
+        r.ops = ops;
+        r.seconds = best;
+        r.peakRssKb = peakRssKb();
+        r.extra = extra;
+        rows.push_back(r);
+    }
+}
+
+/**
+ * The string-key phases: insert, find (probe keys), prefix (prefix scans,
+ * ops = keys visited + scans) and remove, best of --reps each.
+ */
+template<class Adapter>
+static void runStringWorkload(const string& treeName, const StringWorkload& w, size_t n,
+                              const BenchConfig& cfg, vector<BenchResult>& rows)
+{
+    const char* phases[] = { "insert", "find", "prefix", "remove" };
+    for (size_t p = 0; p < sizeof(phases) / sizeof(phases[0]); ++p) {
+        string op = phases[p];
+        double best = 1e300;
+        size_t ops = 0;
+        string extra;
+        bool supported = true;
+        for (int rep = 0; rep < cfg.reps && supported; ++rep) {
+            Adapter* a = new Adapter;
+            double t0 = 0, t1 = 0;
+            long sum = 0;
+            if (op == "insert") {
+                t0 = now();
+                for (size_t i = 0; i < n; ++i) a->insert(w.build[i], int(i));
+                t1 = now();
+                ops = n;
+            }
+            else {
+                for (size_t i = 0; i < n; ++i) a->insert(w.build[i], int(i));
+                if (op == "find") {
+                    t0 = now();
+                    for (size_t i = 0; i < n; ++i) sum += a->find(w.probe[i]);
+                    t1 = now();
+                    ops = n;
+                }
+                else if (op == "prefix") {
+                    t0 = now();
+                    for (size_t i = 0; i < w.prefixes.size(); ++i) {
+                        long c = a->prefixCount(w.prefixes[i]);
+                        if (c < 0) {
+                            supported = false;
+                            break;
+                        }
+                        sum += c;
+                    }
+                    t1 = now();
+                    ops = size_t(sum) + w.prefixes.size();
+                }
+                else {
+                    t0 = now();
+                    for (size_t i = 0; i < n; ++i) a->remove(w.build[i]);
+                    t1 = now();
+                    ops = n;
+                }
+            }
+            benchSink = sum;
+            best = std::min(best, t1 - t0);
+            extra = a->extra();
+            delete a;
+        }
+        if (!supported) continue;
+
+        BenchResult r;
+        r.tree = treeName;
+        r.workload = w.name;
+        r.op = op;
+        r.n = n;
+        r.ops = ops;
+        r.seconds = best;
+        r.peakRssKb = peakRssKb();
+        r.extra = extra;
+        rows.push_back(r);
+    }
+}
+
+/**
+ * The interval phases: insert, stab, overlap and remove, best of --reps
+ * each. Query phases report the average hits per query in extra.
+ */
+template<class Adapter>
+static void runIntervalWorkload(const string& treeName, const IntervalWorkload& w, size_t n,
+                                const BenchConfig& cfg, vector<BenchResult>& rows)
+{
+    const char* phases[] = { "insert", "stab", "overlap", "remove" };
+    for (size_t p = 0; p < sizeof(phases) / sizeof(phases[0]); ++p) {
+        string op = phases[p];
+        double best = 1e300;
+        size_t ops = 0;
+        size_t hits = 0;
+        for (int rep = 0; rep < cfg.reps; ++rep) {
+            Adapter* a = new Adapter;
+            double t0 = 0, t1 = 0;
+            if (op == "insert") {
+                t0 = now();
+                for (size_t i = 0; i < n; ++i) a->insert(w.build[i], int(i));
+                t1 = now();
+                ops = n;
+            }
+            else {
+                for (size_t i = 0; i < n; ++i) a->insert(w.build[i], int(i));
+                if (op == "remove") {
+                    t0 = now();
+                    for (size_t i = 0; i < n; ++i) a->remove(w.build[i]);
+                    t1 = now();
+                    ops = n;
+                }
+                else {
+                    bool stab = (op == "stab");
+                    hits = 0;
+                    t0 = now();
+                    for (size_t i = 0; i < w.queries.size(); ++i) {
+                        const Interval<int>& q = w.queries[i];
+                        hits += a->overlapping(q.lo, stab ? q.lo : q.hi);
+                    }
+                    t1 = now();
+                    ops = w.queries.size();
+                }
+            }
+            benchSink = long(hits);
+            best = std::min(best, t1 - t0);
+            delete a;
+        }
+
+        BenchResult r;
+        r.tree = treeName;
+        r.workload = w.name;
+        r.op = op;
+        r.n = n;
+        r.ops = ops;
+        r.seconds = best;
+        r.peakRssKb = peakRssKb();
+        if (op == "stab" || op == "overlap") {
+            ostringstream os;
+            os << "hits_per_query=" << std::fixed << std::setprecision(1) << double(hits) / ops;
+            r.extra = os.str();
+        }
+        rows.push_back(r);
+    }
+}
+
+/**
+ * MappedAVLTree phases: insert, find, open and remove, best of --reps
+ * each, on a fresh /dev/shm file per repetition.
+ */
+static void runMappedWorkload(const Workload& w, size_t n, const BenchConfig& cfg, vector<BenchResult>& rows)
+{
+    const string path = "/dev/shm/bst-bench-" + std::to_string(getpid()) + ".avl";
+    const char* phases[] = { "insert", "find", "open", "remove" };
+    for (size_t p = 0; p < sizeof(phases) / sizeof(phases[0]); ++p) {
+        string op = phases[p];
+        double best = 1e300;
+        size_t ops = 0;
+        long bytes = 0;
+        for (int rep = 0; rep < cfg.reps; ++rep) {
+            MappedAVLTree<int, int>* t = new MappedAVLTree<int, int>(path, MAP_CREATE, n);
+            double t0 = 0, t1 = 0;
+            long sum = 0;
+            if (op == "insert") {
+                t0 = now();
+                for (size_t i = 0; i < n; ++i) t->insert(std::make_pair(w.build[i], int(i)));
+                t1 = now();
+                ops = n;
+            }
+            else {
+                for (size_t i = 0; i < n; ++i) t->insert(std::make_pair(w.build[i], int(i)));
+                if (op == "find") {
+                    t0 = now();
+                    for (size_t i = 0; i < n; ++i) sum += t->contains(w.probe[i]);
+                    t1 = now();
+                    ops = n;
+                }
+                else if (op == "open") {
+                    t0 = now();
+                    MappedAVLTree<int, int> reader(path, MAP_READER);
+                    sum += reader.contains(w.probe[0]);
+                    t1 = now();
+                    ops = 1;
+                }
+                else {
+                    t0 = now();
+                    for (size_t i = 0; i < n; ++i) t->remove(w.removeOrder[i]);
+                    t1 = now();
+                    ops = n;
+                }
+            }
+            struct stat st;
+            if (stat(path.c_str(), &st) == 0) bytes = long(st.st_size);
+            benchSink = sum;
+            best = std::min(best, t1 - t0);
+            delete t;
+            unlink(path.c_str());
+        }
+
+        BenchResult r;
+        r.tree = "mapped";
+        r.workload = w.name;
+        r.op = op;
+        r.n = n;
+        r.ops = ops;
+        r.seconds = best;
+        r.peakRssKb = peakRssKb();
+        r.extra = "file_bytes=" + std::to_string(bytes);
+        rows.push_back(r);
+    }
+}
+
+static void runCase(const string& tree, const string& workload, const BenchConfig& cfg,
+                    vector<BenchResult>& rows)
+{
+    size_t n = cfg.n;
+    //the unbalanced tree degrades to a list on sorted input: O(n^2) and an
+    //n-deep recursive clear, so it gets a smaller n there
+    if (tree == "bst" && workload == "sequential") n = std::min(n, cfg.degenerateCap);
+    if (isStringWorkload(workload)) {
+        StringWorkload w = makeStringWorkload(workload, n);
+        if (tree == "avl") runStringWorkload<StringTreeAdapter<AVLTree<string, int> > >("avl", w, n, cfg, rows);
+        else if (tree == "string-avl") runStringWorkload<StringAVLAdapter>("string-avl", w, n, cfg, rows);
+        else if (tree == "map") runStringWorkload<StringMapAdapter>("map", w, n, cfg, rows);
+        //other trees have no string-key variant here
+        return;
+    }
+    if (isIntervalWorkload(workload)) {
+        IntervalWorkload w = makeIntervalWorkload(workload, n);
+        if (tree == "interval") runIntervalWorkload<IntervalTreeAdapter>("interval", w, n, cfg, rows);
+        else if (tree == "avl") {
+            runIntervalWorkload<IntervalScanAdapter<AVLTree<Interval<int>, int> > >("avl", w, n, cfg, rows);
+        }
+        else if (tree == "map") {
+            runIntervalWorkload<IntervalScanAdapter<std::map<Interval<int>, int> > >("map", w, n, cfg, rows);
+        }
+        return;
+    }
+    Workload w = makeWorkload(workload, n);
+
+    if (tree == "bst") runWorkload<TreeAdapter<BinarySearchTree<int, int> > >("bst", w, n, cfg, rows);
+    else if (tree == "bst-sg") runWorkload<ScapegoatAdapter<BinarySearchTree<int, int> > >("bst-sg", w, n, cfg, rows);
+    else if (tree == "avl") runWorkload<TreeAdapter<AVLTree<int, int> > >("avl", w, n, cfg, rows);
+    else if (tree == "wavl") runWorkload<TreeAdapter<WAVLTree<int, int> > >("wavl", w, n, cfg, rows);
+    else if (tree == "avl-stats") runWorkload<StatsAdapter<AVLTree<int, int, AVLStats> > >("avl-stats", w, n, cfg, rows);
+    else if (tree == "wavl-stats") runWorkload<StatsAdapter<WAVLTree<int, int, AVLStats> > >("wavl-stats", w, n, cfg, rows);
+    else if (tree == "avl-filter") {
+        benchFilterKeys = n;
+        runWorkload<FilterAdapter<AVLTree<int, int> > >("avl-filter", w, n, cfg, rows);
+    }
+    else if (tree == "avl-sum") runWorkload<SumAdapter>("avl-sum", w, n, cfg, rows);
+    else if (tree == "avl-timed") runWorkload<TimedAdapter>("avl-timed", w, n, cfg, rows);
+    else if (tree == "mapped") runMappedWorkload(w, n, cfg, rows);
+    else if (tree == "avl-cache") runWorkload<CacheAdapter<AVLTree<int, int> > >("avl-cache", w, n, cfg, rows);
+    else if (tree == "splay") runWorkload<SplayAdapter<SplayTree<int, int> > >("splay", w, n, cfg, rows);
+    else if (tree == "semisplay") runWorkload<SemiSplayAdapter>("semisplay", w, n, cfg, rows);
+    else if (tree == "map") runWorkload<MapAdapter>("map", w, n, cfg, rows);
+    else if (tree == "string-avl") return; //string workloads only
+    else if (tree == "interval") return;   //interval workload only
+    else cerr << "unknown tree: " << tree << endl;
+}
+
+/*
+  ----------------------------------------
+  Process isolation
+  ----------------------------------------
+*/
+
+static string serialize(const BenchResult& r)
+{
+    ostringstream os;
+    os << r.tree << '\t' << r.workload << '\t' << r.op << '\t' << r.n << '\t' << r.ops << '\t'
+       << std::setprecision(17) << r.seconds << '\t' << r.peakRssKb << '\t' << r.extra << '\n';
+    return os.str();
+}
+
+static bool deserialize(const string& line, BenchResult& r)
+{
+    istringstream is(line);
+    string field;
+    vector<string> f;
+    while (std::getline(is, field, '\t')) f.push_back(field);
+    if (f.size() < 7) return false;
+    r.tree = f[0];
+    r.workload = f[1];
+    r.op = f[2];
+    r.n = std::strtoul(f[3].c_str(), NULL, 10);
+    r.ops = std::strtoul(f[4].c_str(), NULL, 10);
+    r.seconds = std::strtod(f[5].c_str(), NULL);
+    r.peakRssKb = std::strtol(f[6].c_str(), NULL, 10);
+    r.extra = f.size() > 7 ? f[7] : "";
+    return true;
+}
+
+/**
+ * Runs one case in a child process and collects its rows through a pipe,
+ * so the child's peak RSS is not polluted by earlier cases.
+ */
+static void runIsolated(const string& tree, const string& workload, const BenchConfig& cfg,
+                        vector<BenchResult>& rows)
+{
+    int fds[2];
+    if (pipe(fds) != 0) {
+        runCase(tree, workload, cfg, rows);
+        return;
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        runCase(tree, workload, cfg, rows);
+        return;
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        vector<BenchResult> childRows;
+        runCase(tree, workload, cfg, childRows);
+        string out;
+        for (size_t i = 0; i < childRows.size(); ++i) out += serialize(childRows[i]);
+        const char* p = out.data();
+        size_t left = out.size();
+        while (left > 0) {
+            ssize_t w = write(fds[1], p, left);
+            if (w <= 0) break;
+            p += w;
+            left -= size_t(w);
+        }
+        close(fds[1]);
+        _exit(0);
+    }
+
+    close(fds[1]);
+    string data;
+    char buf[4096];
+    ssize_t got;
+    while ((got = read(fds[0], buf, sizeof(buf))) > 0) data.append(buf, size_t(got));
+    close(fds[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        cerr << "case " << tree << "/" << workload << " failed" << endl;
+    }
+
+    istringstream lines(data);
+    string line;
+    while (std::getline(lines, line)) {
+        BenchResult r;
+        if (deserialize(line, r)) rows.push_back(r);
+    }
+}
+
+/*
+  ----------------------------------------
+  Output
+  ----------------------------------------
+*/
+
+static double opsPerSec(const BenchResult& r)
+{
+    return r.seconds > 0 ? r.ops / r.seconds : 0;
+}
+
+static double nsPerOp(const BenchResult& r)
+{
+    return r.ops > 0 ? r.seconds * 1e9 / r.ops : 0;
+}
+
+static void writeTable(ostream& os, const vector<BenchResult>& rows)
+{
+    os << std::left << setw(12) << "tree" << setw(14) << "workload" << setw(18) << "op"
+       << std::right << setw(10) << "n" << setw(14) << "ops/sec" << setw(12) << "ns/op"
+       << setw(14) << "peak_rss_kb" << "  extra" << endl;
+    for (size_t i = 0; i < rows.size(); ++i) {
+        const BenchResult& r = rows[i];
+        os << std::left << setw(12) << r.tree << setw(14) << r.workload << setw(18) << r.op
+           << std::right << setw(10) << r.n << setw(14) << std::fixed << std::setprecision(0) << opsPerSec(r)
+           << setw(12) << std::setprecision(1) << nsPerOp(r) << setw(14) << r.peakRssKb
+           << "  " << r.extra << endl;
+    }
+}
+
+static void writeCSV(ostream& os, const vector<BenchResult>& rows)
+{
+    os << "tree,workload,op,n,ops,seconds,ops_per_sec,ns_per_op,peak_rss_kb,extra" << endl;
+    for (size_t i = 0; i < rows.size(); ++i) {
+        const BenchResult& r = rows[i];
+        os << r.tree << ',' << r.workload << ',' << r.op << ',' << r.n << ',' << r.ops << ','
+           << std::setprecision(9) << r.seconds << ',' << std::fixed << std::setprecision(1)
+           << opsPerSec(r) << ',' << nsPerOp(r) << ',' << r.peakRssKb << ",\"" << r.extra << "\"" << endl;
+        os.unsetf(std::ios::fixed);
+    }
+}
+
+static void writeJSON(ostream& os, const vector<BenchResult>& rows)
+{
+    os << "[" << endl;
+    for (size_t i = 0; i < rows.size(); ++i) {
+        const BenchResult& r = rows[i];
+        os << "  {\"tree\": \"" << r.tree << "\", \"workload\": \"" << r.workload
+           << "\", \"op\": \"" << r.op << "\", \"n\": " << r.n << ", \"ops\": " << r.ops
+           << ", \"seconds\": " << std::setprecision(9) << r.seconds
+           << ", \"ops_per_sec\": " << std::fixed << std::setprecision(1) << opsPerSec(r)
+           << ", \"ns_per_op\": " << nsPerOp(r) << ", \"peak_rss_kb\": " << r.peakRssKb
+           << ", \"extra\": \"" << r.extra << "\"}" << (i + 1 < rows.size() ? "," : "") << endl;
+        os.unsetf(std::ios::fixed);
+    }
+    os << "]" << endl;
+}
+
+/*
+  ----------------------------------------
+  Command line
+  ----------------------------------------
+*/
+
+static vector<string> splitList(const string& s)
+{
+    vector<string> out;
+    string item;
+    istringstream is(s);
+    while (std::getline(is, item, ',')) {
+        if (!item.empty()) out.push_back(item);
+    }
+    return out;
+}
+
+static void usage(const char* prog)
+{
+    cerr << "usage: " << prog << " [--n N] [--reps R] [--degenerate-cap N]\n"
+         << "       [--trees bst,bst-sg,avl,wavl,avl-cache,avl-filter,splay,semisplay,avl-stats,\n"
+         << "                wavl-stats,avl-sum,avl-timed,mapped,string-avl,interval,map]\n"
+         << "       [--workloads uniform,sequential,zipf,zipf-drift,delete-heavy,urls,paths,intervals]\n"
+         << "       [--batch 1,2,4,8,16,32,64] [--sorted] [--upsert] [--merge] [--aggregate]\n"
+         << "       [--rebalance] [--export]\n"
+         << "       [--format table|csv|json] [--out FILE]" << endl;
+}
+
+int main(int argc, char* argv[])
+{
+    BenchConfig cfg;
+    cfg.n = 100000;
+    cfg.reps = 3;
+    cfg.degenerateCap = 5000;
+    cfg.trees = splitList("bst,avl,map");
+    cfg.workloads = splitList("uniform,sequential,zipf,delete-heavy");
+    cfg.sortedPhases = false;
+    cfg.upsertPhases = false;
+    cfg.mergePhases = false;
+    cfg.aggregatePhases = false;
+    cfg.rebalancePhases = false;
+    cfg.exportPhases = false;
+    cfg.format = "table";
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+        if (arg == "--n" && hasValue) cfg.n = std::strtoul(argv[++i], NULL, 10);
+        else if (arg == "--reps" && hasValue) cfg.reps = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--degenerate-cap" && hasValue) cfg.degenerateCap = std::strtoul(argv[++i], NULL, 10);
+        else if (arg == "--trees" && hasValue) cfg.trees = splitList(argv[++i]);
+        else if (arg == "--workloads" && hasValue) cfg.workloads = splitList(argv[++i]);
+        else if (arg == "--batch" && hasValue) {
+            vector<string> lanes = splitList(argv[++i]);
+            for (size_t l = 0; l < lanes.size(); ++l) {
+                size_t v = std::strtoul(lanes[l].c_str(), NULL, 10);
+                if (v == 0 || v > 64 || (v & (v - 1)) != 0) {
+                    cerr << "--batch: lane counts must be powers of two up to 64" << endl;
+                    return 1;
+                }
+                cfg.batchLanes.push_back(v);
+            }
+        }
+        else if (arg == "--sorted") cfg.sortedPhases = true;
+        else if (arg == "--upsert") cfg.upsertPhases = true;
+        else if (arg == "--merge") cfg.mergePhases = true;
+        else if (arg == "--aggregate") cfg.aggregatePhases = true;
+        else if (arg == "--rebalance") cfg.rebalancePhases = true;
+        else if (arg == "--export") cfg.exportPhases = true;
+        else if (arg == "--format" && hasValue) cfg.format = argv[++i];
+        else if (arg == "--out" && hasValue) cfg.out = argv[++i];
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    vector<BenchResult> rows;
+    for (size_t w = 0; w < cfg.workloads.size(); ++w) {
+        for (size_t t = 0; t < cfg.trees.size(); ++t) {
+            runIsolated(cfg.trees[t], cfg.workloads[w], cfg, rows);
+        }
+    }
+
+    ofstream file;
+    if (!cfg.out.empty()) {
+        file.open(cfg.out.c_str());
+        if (!file) {
+            cerr << "cannot open " << cfg.out << endl;
+            return 1;
+        }
+    }
+    ostream& os = cfg.out.empty() ? cout : file;
+
+    if (cfg.format == "csv") writeCSV(os, rows);
+    else if (cfg.format == "json") writeJSON(os, rows);
+    else writeTable(os, rows);
+
+    return 0;
+}
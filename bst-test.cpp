@@ -1,10 +1,30 @@
 #include <iostream>
 #include <map>
+#include <algorithm>
+#include <iterator>
+#include <vector>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
 #include "bst.h"
 #include "avlbst.h"
+#include "splaybst.h"
+#include "stringavlbst.h"
+#include "intervalbst.h"
+#include "augmentedbst.h"
+#include "mappedavlbst.h"
+#include "bst_latency.h"
 
 using namespace std;
 
+// occurrences of what in s, to summarise exporter output (node ids are addresses)
+static size_t countOf(const string& s, const string& what)
+{
+    size_t count = 0;
+    for (size_t pos = s.find(what); pos != string::npos; pos = s.find(what, pos + what.size())) ++count;
+    return count;
+}
 
 int main(int argc, char *argv[])
 {
@@ -29,6 +49,26 @@ int main(int argc, char *argv[])
     bt.remove('b');
 
 
+    // scapegoat policy: sorted inserts no longer build a list
+    BinarySearchTree<int,int> sg;
+    sg.enableScapegoat();
+    for(int i = 0; i < 1000; ++i) sg.insert(std::make_pair(i, i));
+    for(int i = 0; i < 600; ++i) sg.remove(i);
+    cout << "Scapegoat BST: size=" << sg.size() << " shape: " << sg.shape_report() << endl;
+    cout << "Scapegoat stats: " << sg.scapegoatStats().toJSON() << endl;
+
+    // one-off rebalance: a list of sorted inserts becomes a balanced tree
+    BinarySearchTree<int,int> vine;
+    for(int i = 0; i < 100; ++i) vine.insert(std::make_pair(i, i));
+    vine.rebalance();
+    AVLTree<int,int> ab;
+    for(int i = 0; i < 100; ++i) ab.insert(std::make_pair(i, i));
+    ab.rebalance();
+    ab.remove(0);
+    cout << "rebalance: balanced=" << vine.isBalanced() << " shape: " << vine.shape_report() << endl;
+    cout << "AVL rebalance then remove: balanced=" << ab.isBalanced() << " size=" << ab.size() << endl;
+
+
     // AVL Tree Tests
     AVLTree<char,int> at;
     at.insert(std::make_pair('a',1));
@@ -47,6 +87,179 @@ int main(int argc, char *argv[])
     cout << "Erasing b" << endl;
     at.remove('b');
 
+    // Instrumented AVL tree
+    AVLTree<int,int,AVLStats> st;
+    for(int i = 0; i < 64; ++i) st.insert(std::make_pair(i, i));
+    for(int i = 0; i < 64; i += 2) st.remove(i);
+    cout << "\nAVLTree stats:" << endl << st.stats();
+    cout << "AVLTree shape: " << st.shape_report() << endl;
+    cout << "AVLTree metrics: " << st.metrics().toJSON() << endl;
+
+    // same operations, weak-AVL balancing
+    WAVLTree<int,int,AVLStats> wt;
+    for(int i = 0; i < 64; ++i) wt.insert(std::make_pair(i, i));
+    for(int i = 0; i < 64; i += 2) wt.remove(i);
+    cout << "\nWAVLTree stats:" << endl << wt.stats();
+    cout << "WAVLTree shape: " << wt.shape_report() << endl;
+
+    // splay tree: the last key found ends up at the root
+    SplayTree<int,int> sp;
+    for(int i = 0; i < 16; ++i) sp.insert(std::make_pair(i, i * i));
+    sp.remove(3);
+    cout << "\nSplayTree find(7): " << sp.find(7)->second << ", find(3) found: " << (sp.find(3) != sp.end()) << endl;
+    sp.print();
+
+    // exporter: DOT and JSON, whole tree, subtree, depth-limited, sampled
+    {
+        ostringstream dot, json, sub, shallow, sampled;
+        TreeExportOptions opts;
+        st.exportTree(dot, opts);
+        opts.format = TreeExportOptions::JSON;
+        opts.withValues = true;
+        st.exportTree(json, opts);
+        st.exportSubtree(sub, 31, opts);
+        opts.maxDepth = 1;
+        st.exportTree(shallow, opts);
+        opts.maxDepth = -1;
+        opts.sampleEvery = 4;
+        st.exportTree(sampled, opts);
+        cout << "export: dot nodes=" << countOf(dot.str(), "[label=\"") - countOf(dot.str(), "->")
+             << " edges=" << countOf(dot.str(), "->") << " json nodes=" << countOf(json.str(), "\"id\"")
+             << " balance tags=" << countOf(json.str(), "\"balance\"") << " subtree(31)=" << countOf(sub.str(), "\"id\"")
+             << " depth<=1=" << countOf(shallow.str(), "\"id\"")
+             << " sampled<all=" << (countOf(sampled.str(), "\"id\"") < st.size()) << endl;
+    }
+
+    // lookup cache: second find hits, remove invalidates
+    AVLTree<int,int> ct;
+    ct.enableLookupCache(16);
+    for(int i = 0; i < 32; ++i) ct.insert(std::make_pair(i, i));
+    ct.find(5); ct.find(5); ct.remove(5);
+    cout << "\nLookup cache: find(5) after remove found: " << (ct.find(5) != ct.end())
+         << " " << ct.lookupCacheStats().toJSON() << endl;
+
+    // membership filter: absent keys are rejected without a descent
+    ct.enableMembershipFilter(64);
+    for(int i = 100; i < 110; ++i) ct.find(i);
+    cout << "Membership filter: " << ct.membershipFilterStats().toJSON() << endl;
+
+    // batched find: one result per key, end() for absent ones
+    int keys[] = { 7, 5, 31, 40, 0 };
+    AVLTree<int,int>::iterator found[5];
+    ct.find_batch<4>(keys, keys + 5, found);
+    cout << "find_batch:";
+    for(int i = 0; i < 5; ++i) cout << " " << (found[i] != ct.end() ? found[i]->first : -1);
+    cout << endl;
+
+    // sorted lookups: one finger walk instead of a descent per key
+    bool has[5];
+    std::sort(keys, keys + 5);
+    ct.contains_sorted(keys, keys + 5, has);
+    cout << "contains_sorted:";
+    for(int i = 0; i < 5; ++i) cout << " " << keys[i] << "=" << has[i];
+    cout << endl;
+
+    // counters: one descent per update, inserting missing keys
+    AVLTree<std::string,int> words;
+    const char* text[] = { "a", "b", "a", "c", "a", "b" };
+    for(int i = 0; i < 6; ++i) words.upsert(text[i], [](int& n) { ++n; });
+    words.at_or_insert("d") += 10;
+    cout << "word counts:";
+    for(AVLTree<std::string,int>::iterator it = words.begin(); it != words.end(); ++it) cout << " " << it->first << "=" << it->second;
+    cout << endl;
+
+    // copies keep the shape; moves and swaps are O(1)
+    AVLTree<std::string,int> copy(words);
+    copy.upsert("a", [](int& n) { n = 0; });
+    AVLTree<std::string,int> moved(std::move(copy));
+    cout << "copy: words[a]=" << words["a"] << " moved[a]=" << moved["a"]
+         << " moved-from empty=" << copy.empty() << " same shape=" << (moved.shape_report() == words.shape_report()) << endl;
+    // so a vector of trees moves them when it grows instead of copying
+    static_assert(std::is_nothrow_move_constructible<AVLTree<int,int> >::value, "AVLTree move may throw");
+    static_assert(std::is_nothrow_move_assignable<AVLTree<int,int> >::value, "AVLTree move may throw");
+    static_assert(std::is_nothrow_move_constructible<StringAVLTree<int> >::value, "StringAVLTree move may throw");
+    static_assert(std::is_nothrow_move_constructible<IntervalTree<int,int> >::value, "IntervalTree move may throw");
+    static_assert(std::is_nothrow_move_constructible<AugmentedAVLTree<int,int,SumMonoid<int> > >::value,
+                  "AugmentedAVLTree move may throw");
+    // swapping through a base reference refuses trees of different types
+    AVLTree<int,int> avlSide;
+    BinarySearchTree<int,int> plainSide;
+    plainSide.insert(std::make_pair(1, 1));
+    bool refused = false;
+    try { static_cast<BinarySearchTree<int,int>&>(avlSide).swap(plainSide); }
+    catch (const std::invalid_argument&) { refused = true; }
+    cout << "swap AVL with plain refused=" << refused << " plain size=" << plainSide.size() << endl;
+
+    // merge: the source's nodes are relinked, not copied
+    AVLTree<std::string,int> more;
+    more.insert(std::make_pair(std::string("e"), 5));
+    more.insert(std::make_pair(std::string("a"), 99));
+    words.merge(std::move(more));
+    cout << "merge: size=" << words.size() << " a=" << words["a"] << " e=" << words["e"]
+         << " source empty=" << more.empty() << " balanced=" << words.isBalanced() << endl;
+
+    // string keys: cached key slices and prefix scans
+    StringAVLTree<int> urls;
+    const char* paths[] = { "/usr/lib/a.so", "/usr/lib/b.so", "/usr/bin/ls", "/usr/libexec/x", "/etc/hosts" };
+    for(int i = 0; i < 5; ++i) urls.insert(std::make_pair(std::string(paths[i]), i));
+    cout << "StringAVLTree find(/usr/bin/ls): " << urls["/usr/bin/ls"] << ", prefix /usr/lib/:";
+    std::pair<StringAVLTree<int>::iterator, StringAVLTree<int>::iterator> pr = urls.prefix_range("/usr/lib/");
+    for(StringAVLTree<int>::iterator it = pr.first; it != pr.second; ++it) cout << " " << it->first;
+    cout << endl;
+
+    // interval tree: overlap queries skip subtrees that end too early
+    IntervalTree<int,int> spans;
+    spans.insert(1, 5, 0);
+    spans.insert(3, 9, 1);
+    spans.insert(8, 12, 2);
+    spans.insert(20, 30, 3);
+    spans.remove(3, 9);
+    std::vector<IntervalTree<int,int>::iterator> hits;
+    spans.overlapping(4, 10, std::back_inserter(hits));
+    cout << "IntervalTree overlapping [4,10]:";
+    for(size_t i = 0; i < hits.size(); ++i) cout << " " << hits[i]->first;
+    hits.clear();
+    spans.overlapping(25, std::back_inserter(hits));
+    cout << ", containing 25: " << hits.size() << ", max end: " << spans.maxEnd() << endl;
+
+    // range aggregates: O(log n) from the subtree summaries
+    AugmentedAVLTree<int,int,SumMonoid<long> > sums;
+    AugmentedAVLTree<int,int,MaxMonoid<int> > maxes;
+    for(int i = 1; i <= 100; ++i) {
+        sums.insert(std::make_pair(i, i));
+        maxes.insert(std::make_pair(i, (i * 37) % 101));
+    }
+    sums.remove(50);
+    sums.upsert(10, [](int& v) { v += 1000; });
+    cout << "aggregate: sum[1,101)=" << sums.aggregate(1, 101) << " sum[40,60)=" << sums.aggregate(40, 60)
+         << " max[1,20)=" << maxes.aggregate(1, 20) << " empty=" << sums.aggregate(200, 300) << endl;
+
+    // latency histograms: every call timed (sampleShift 0)
+    TimedTree<AVLTree<int,int> > timed;
+    for(int i = 0; i < 100; ++i) timed.insert(std::make_pair(i, i));
+    for(int i = 0; i < 200; ++i) timed.find(i);
+    timed.remove(5);
+    timed[6] = 60;
+    const LatencyHistogram& fh = timed.latency(TimedTree<AVLTree<int,int> >::FIND);
+    cout << "TimedTree: inserts timed=" << timed.latency(TimedTree<AVLTree<int,int> >::INSERT).count()
+         << " finds timed=" << fh.count() << " p50<=p99=" << (fh.percentile(0.5) <= fh.percentile(0.99))
+         << " size=" << timed.tree().size() << endl;
+
+    // file-backed tree: a second mapping (another process, usually) reads
+    // what the writer stored, no rebuilding; opened first, it remaps as
+    // the writer grows the file
+    {
+        const char* file = "/tmp/bst-test-mapped.avl";
+        MappedAVLTree<int,double> writer(file, MAP_CREATE, 4);
+        MappedAVLTree<int,double> reader(file, MAP_READER);
+        for(int i = 0; i < 100; ++i) writer.insert(std::make_pair(i, i / 4.0));
+        writer.remove(7);
+        double v = 0;
+        cout << "MappedAVLTree: size=" << reader.size() << " find(42)=" << reader.find(42, v) << " " << v
+             << " contains(7)=" << reader.contains(7) << endl;
+        unlink(file);
+    }
+
 
 
   //printing 
@@ -4,7 +4,12 @@
 #include <iostream>
 #include <exception>
 #include <cstdlib>
+#include <stdexcept>
+#include <typeinfo>
 #include <utility>
+#include <string>
+#include <vector>
+#include "tree_metrics.h"
 
 /**
  * A templated class for a Node in a search tree.
@@ -211,6 +216,36 @@ void Node<Key, Value>::setValue(const Value& value)
   ---------------------------------------
 */
 
+// Shape statistics of a tree, defined in bst_shape.h
+struct BSTShapeReport;
+
+// Optional lookup cache and its counters, defined in bst_cache.h
+template<typename Key, typename Value> class BSTLookupCache;
+struct LookupCacheStats;
+
+// Optional membership filter and its counters, defined in bst_filter.h
+template<typename Key> class BSTMembershipFilter;
+struct MembershipFilterStats;
+
+// Optional scapegoat rebuilding and its counters, defined in bst_scapegoat.h
+template<typename Key, typename Value> class BSTScapegoat;
+struct ScapegoatStats;
+
+/**
+* Options for BinarySearchTree::exportTree / exportSubtree (see bst_export.h).
+*/
+struct TreeExportOptions
+{
+    enum Format { DOT, JSON };
+
+    Format format;
+    int maxDepth;        // levels below the start node to emit, -1 for all
+    size_t sampleEvery;  // keep roughly one node in sampleEvery, 1 keeps all
+    bool withValues;     // include values as well as keys
+
+    TreeExportOptions() : format(DOT), maxDepth(-1), sampleEvery(1), withValues(false) {}
+};
+
 /**
 * A templated unbalanced binary search tree.
 */
@@ -222,6 +257,22 @@ public:
     //ctor 
     BinarySearchTree(); //TODO
 
+    //copy: clones the structure node for node in O(n), no re-inserting;
+    //the copy gets its own (empty) lookup cache and a copy of the filter
+    BinarySearchTree(const BinarySearchTree& other);
+    BinarySearchTree& operator=(const BinarySearchTree& other);
+
+    //move: O(1), takes the nodes, cache and filter; other is left empty.
+    //noexcept, so containers of trees move them on reallocation
+    BinarySearchTree(BinarySearchTree&& other) noexcept;
+    BinarySearchTree& operator=(BinarySearchTree&& other) noexcept;
+
+    //swap: O(1) exchange of contents with a tree of the same type; each
+    //derived tree hides it with a swap taking its own type. Reached through
+    //a base reference, it throws std::invalid_argument if the two trees'
+    //dynamic types differ (their nodes would be of different types)
+    void swap(BinarySearchTree& other);
+
     //virtual dtor 
     virtual ~BinarySearchTree(); //TODO
 
@@ -234,11 +285,55 @@ public:
     //clear - delete all nodes, turns into empty tree 
     void clear(); //TODO
 
+    //rebalance: reshapes the tree into a height-balanced one with rotations
+    //(Day-Stout-Warren), O(n) time and O(1) extra space. Nodes are relinked,
+    //so iterators stay valid. Balanced trees also recompute their tags
+    virtual void rebalance();
+
     //isBalanced: T if AVL tree (balanced)
     bool isBalanced() const; //TODO
 
     void print() const;
     bool empty() const;
+    //number of keys, O(1)
+    size_t size() const { return size_; }
+
+    //shape: height, depth histogram, path lengths, fill ratio in one O(n) pass
+    BSTShapeReport shape() const;
+    //shape_report: shape() as a JSON object
+    std::string shape_report() const;
+
+    //metrics: leaf depths, equal paths, full/perfect/complete in one pass
+    TreeMetrics metrics() const;
+
+    //exportTree: stream the tree as Graphviz DOT or JSON in one O(n) pass, O(1) memory
+    void exportTree(std::ostream& os, const TreeExportOptions& opts = TreeExportOptions()) const;
+    //exportSubtree: same, rooted at the node holding key (empty output if absent)
+    void exportSubtree(std::ostream& os, const Key& key,
+                       const TreeExportOptions& opts = TreeExportOptions()) const;
+
+    //lookup cache: a small set-associative key -> node table in front of
+    //find and operator[] (see bst_cache.h); off until enabled
+    void enableLookupCache(size_t sets = 256);
+    void disableLookupCache();
+    LookupCacheStats lookupCacheStats() const;
+    void resetLookupCacheStats();
+
+    //membership filter: a counting Bloom filter that lets find, operator[]
+    //and remove reject absent keys without a descent (see bst_filter.h)
+    void enableMembershipFilter(size_t expectedKeys = 1024);
+    void disableMembershipFilter();
+    MembershipFilterStats membershipFilterStats() const;
+    void resetMembershipFilterStats();
+
+    //scapegoat policy: keeps the height within log_{1/alpha}(n) by rebuilding
+    //the subtree above a too-deep insert, amortized O(log n) per update and
+    //no per-node data (see bst_scapegoat.h). Off until enabled; AVLTree and
+    //SplayTree balance themselves and ignore it
+    void enableScapegoat(double alpha = 2.0 / 3.0);
+    void disableScapegoat();
+    ScapegoatStats scapegoatStats() const;
+    void resetScapegoatStats();
 
     template<typename PPKey, typename PPValue>
     friend void prettyPrintBST(BinarySearchTree<PPKey, PPValue> & tree);
@@ -272,7 +367,30 @@ public:
     Value& operator[](const Key& key);
     Value const & operator[](const Key& key) const;
 
+    //at_or_insert: operator[] that default-constructs missing keys, like std::map's
+    Value& at_or_insert(const Key& key);
+    //upsert: fn(value) in place, on a default-constructed value if key was
+    //missing; true if it was. One descent, like at_or_insert
+    template<class Fn>
+    bool upsert(const Key& key, Fn fn);
+
+    //find_batch: find() for every key in [first, last) into out[0..], with
+    //Lanes descents interleaved so their cache misses overlap (see bst_batch.h)
+    template<size_t Lanes = 16, class KeyIt, class OutIt>
+    void find_batch(KeyIt first, KeyIt last, OutIt out) const;
+
+    //find_sorted / contains_sorted: find() / find() != end() for every key of
+    //an ascending range, written to *out++. One finger walk over the tree:
+    //each probe resumes from the previous one (see bst_batch.h)
+    template<class KeyIt, class OutIt>
+    void find_sorted(KeyIt first, KeyIt last, OutIt out) const;
+    template<class KeyIt, class OutIt>
+    void contains_sorted(KeyIt first, KeyIt last, OutIt out) const;
+
 protected:
+    //swap's exchange of the members, unchecked
+    void swapContents(BinarySearchTree& other) noexcept;
+
 // Mandatory helper functions
     //returns ptr to the node w key 
     Node<Key, Value>* internalFind(const Key& k) const; // TODO
@@ -287,17 +405,67 @@ protected:
     // Provided helper functions
     virtual void printRoot (Node<Key, Value> *r) const;
     virtual void nodeSwap( Node<Key,Value>* n1, Node<Key,Value>* n2) ;
+    //balance to annotate exported nodes with; false if the tree has none
+    virtual bool nodeBalance(const Node<Key, Value>* n, int& balance) const;
+    void exportFrom(std::ostream& os, Node<Key, Value>* start, const TreeExportOptions& opts) const;
 
     // Add helper functions here
     static Node<Key, Value>* successor(Node<Key, Value>* current);
     void clearSubtrees (Node<Key, Value>* n);
+    //internalFind through the membership filter and lookup cache, if enabled
+    Node<Key, Value>* cachedFind(const Key& k) const;
+    //false if the membership filter proves k is absent
+    bool mayContain(const Key& k) const;
+    //the node holding k, or a new (k, v) node linked (and rebalanced) in
+    //one descent; created tells which. insert() and upsert() go through it
+    virtual Node<Key, Value>* findOrInsert(const Key& k, const Value& v, bool& created);
+    Node<Key, Value>* cachedFindOrInsert(const Key& k, bool& created);
+    //a copy of n (key, value, per-node tags) with the given parent and no
+    //children; derived trees with their own node type override it
+    virtual Node<Key, Value>* cloneNode(const Node<Key, Value>* n, Node<Key, Value>* parent) const;
+    //replaces the contents of this (empty) tree with a copy of other's
+    void copyFrom(const BinarySearchTree& other);
+    //call after linking a new node into the tree
+    void nodeCreated(Node<Key, Value>* n);
+    //rebuilds the membership filter at twice the tree's size
+    void growMembershipFilter();
+    //call before deleting a node that is (or was) in the tree
+    void nodeDestroyed(Node<Key, Value>* n);
+    //iterator at n, for derived trees (the iterator ctor is private to this class)
+    iterator iteratorAt(Node<Key, Value>* n) const { return iterator(n); }
+    //rotations that keep parent pointers and root_ consistent
+    void rotateLeft(Node<Key, Value>* n);
+    void rotateRight(Node<Key, Value>* n);
+    //one rebalance() pass: count left rotations down the right spine
+    void compressVine(size_t count);
     int getHeight(Node<Key, Value>* n) const;
     bool balanceHelper(Node<Key, Value>* n) const;
     void removeNode(Node<Key, Value>* n);
+    //remove() without the scapegoat check
+    void removeKey(const Key& key);
+    //scapegoat hooks: n was just linked at depth; a key was removed
+    void scapegoatInserted(Node<Key, Value>* n, size_t depth);
+    void scapegoatRemoved();
+    static size_t subtreeSize(Node<Key, Value>* n);
+    //relinks the count nodes under n into a perfectly balanced subtree
+    void rebuildSubtree(Node<Key, Value>* n, size_t count);
+    static Node<Key, Value>* buildBalancedFrom(const std::vector<Node<Key, Value>*>& nodes, size_t lo, size_t hi,
+                                               Node<Key, Value>* parent);
+    //calls visit(node or nullptr) for each key of an ascending range
+    template<class KeyIt, class Visit>
+    void sortedWalk(KeyIt first, KeyIt last, Visit visit) const;
 
 protected:
     //ptr to root node 
     Node<Key, Value>* root_;
+    //lookup cache, nullptr when disabled
+    BSTLookupCache<Key, Value>* cache_;
+    //membership filter, nullptr when disabled
+    BSTMembershipFilter<Key>* filter_;
+    //scapegoat policy, nullptr when disabled
+    BSTScapegoat<Key, Value>* scapegoat_;
+    //node count, kept by nodeCreated / nodeDestroyed
+    size_t size_;
     // You should not need other data members
 };
 
@@ -432,8 +600,135 @@ Begin implementations for the BinarySearchTree class.
 * Default constructor for a BinarySearchTree, which sets the root to NULL.
 */
 template<class Key, class Value>
-BinarySearchTree<Key, Value>::BinarySearchTree(): root_(nullptr)
+BinarySearchTree<Key, Value>::BinarySearchTree(): root_(nullptr), cache_(nullptr), filter_(nullptr), scapegoat_(nullptr), size_(0)
+{
+}
+
+template<class Key, class Value>
+BinarySearchTree<Key, Value>::BinarySearchTree(const BinarySearchTree& other):
+    root_(nullptr), cache_(nullptr), filter_(nullptr), scapegoat_(nullptr), size_(0)
+{
+    copyFrom(other);
+}
+
+template<class Key, class Value>
+BinarySearchTree<Key, Value>& BinarySearchTree<Key, Value>::operator=(const BinarySearchTree& other)
+{
+    if (this == &other) return *this;
+    clear();
+    delete cache_;
+    delete filter_;
+    delete scapegoat_;
+    cache_ = nullptr;
+    filter_ = nullptr;
+    scapegoat_ = nullptr;
+    copyFrom(other);
+    return *this;
+}
+
+template<class Key, class Value>
+BinarySearchTree<Key, Value>::BinarySearchTree(BinarySearchTree&& other) noexcept:
+    root_(other.root_), cache_(other.cache_), filter_(other.filter_), scapegoat_(other.scapegoat_),
+    size_(other.size_)
+{
+    other.root_ = nullptr;
+    other.size_ = 0;
+    other.cache_ = nullptr;
+    other.filter_ = nullptr;
+    other.scapegoat_ = nullptr;
+}
+
+template<class Key, class Value>
+BinarySearchTree<Key, Value>& BinarySearchTree<Key, Value>::operator=(BinarySearchTree&& other) noexcept
+{
+    if (this == &other) return *this;
+    clear();
+    delete cache_;
+    delete filter_;
+    delete scapegoat_;
+    root_ = other.root_;
+    cache_ = other.cache_;
+    filter_ = other.filter_;
+    scapegoat_ = other.scapegoat_;
+    size_ = other.size_;
+    other.root_ = nullptr;
+    other.size_ = 0;
+    other.cache_ = nullptr;
+    other.filter_ = nullptr;
+    other.scapegoat_ = nullptr;
+    return *this;
+}
+
+template<class Key, class Value>
+void BinarySearchTree<Key, Value>::swap(BinarySearchTree& other)
+{
+    if (typeid(*this) != typeid(other)) throw std::invalid_argument("swap between different tree types");
+    swapContents(other);
+}
+
+/**
+* Cached Node* entries stay valid: the cache moves with the nodes it points to.
+*/
+template<class Key, class Value>
+void BinarySearchTree<Key, Value>::swapContents(BinarySearchTree& other) noexcept
+{
+    std::swap(root_, other.root_);
+    std::swap(cache_, other.cache_);
+    std::swap(filter_, other.filter_);
+    std::swap(scapegoat_, other.scapegoat_);
+    std::swap(size_, other.size_);
+}
+
+template<class Key, class Value>
+Node<Key, Value>* BinarySearchTree<Key, Value>::cloneNode(const Node<Key, Value>* n, Node<Key, Value>* parent) const
 {
+    return new Node<Key, Value>(n->getKey(), n->getValue(), parent);
+}
+
+/**
+* Preorder walk of other through parent pointers, building the mirror image
+* alongside: O(n) time, O(1) extra space, and the copy has exactly other's
+* shape. The filter already holds other's keys, so it is copied rather than
+* fed through nodeCreated.
+*/
+template<class Key, class Value>
+void BinarySearchTree<Key, Value>::copyFrom(const BinarySearchTree& other)
+{
+    if (other.cache_) {
+        cache_ = new BSTLookupCache<Key, Value>(other.cache_->stats().sets, other.cache_->hashFunction());
+    }
+    if (other.filter_) {
+        filter_ = new BSTMembershipFilter<Key>(*other.filter_);
+        filter_->resetStats();
+    }
+    if (other.scapegoat_) {
+        scapegoat_ = new BSTScapegoat<Key, Value>(*other.scapegoat_);
+        scapegoat_->resetStats();
+    }
+    if (other.root_ == nullptr) return;
+
+    size_ = other.size_;
+    Node<Key, Value>* src = other.root_;
+    Node<Key, Value>* dst = cloneNode(src, nullptr);
+    root_ = dst;
+    while (true) {
+        if (src->getLeft() != nullptr && dst->getLeft() == nullptr) {
+            src = src->getLeft();
+            dst->setLeft(cloneNode(src, dst));
+            dst = dst->getLeft();
+        }
+        else if (src->getRight() != nullptr && dst->getRight() == nullptr) {
+            src = src->getRight();
+            dst->setRight(cloneNode(src, dst));
+            dst = dst->getRight();
+        }
+        else if (src == other.root_) break;
+        else {
+            // both subtrees done: back up
+            src = src->getParent();
+            dst = dst->getParent();
+        }
+    }
 }
 
 template<typename Key, typename Value>
@@ -441,7 +736,9 @@ BinarySearchTree<Key, Value>::~BinarySearchTree()
 {
     clearSubtrees(root_);
     root_=nullptr;
-
+    delete cache_;
+    delete filter_;
+    delete scapegoat_;
 }
 
 /**
@@ -453,6 +750,15 @@ bool BinarySearchTree<Key, Value>::empty() const
     return root_ == NULL;
 }
 
+/**
+ * Leaf-depth and shape checks, see tree_metrics.h
+*/
+template<typename Key, typename Value>
+TreeMetrics BinarySearchTree<Key, Value>::metrics() const
+{
+    return treeMetrics<Node<Key, Value> >(root_);
+}
+
 template<typename Key, typename Value>
 void BinarySearchTree<Key, Value>::print() const
 {
@@ -490,7 +796,7 @@ template<class Key, class Value>
 typename BinarySearchTree<Key, Value>::iterator
 BinarySearchTree<Key, Value>::find(const Key & k) const
 {
-    Node<Key, Value> *curr = internalFind(k);
+    Node<Key, Value> *curr = cachedFind(k);
     BinarySearchTree<Key, Value>::iterator it(curr);
     return it;
 }
@@ -502,14 +808,14 @@ BinarySearchTree<Key, Value>::find(const Key & k) const
 template<class Key, class Value>
 Value& BinarySearchTree<Key, Value>::operator[](const Key& key)
 {
-    Node<Key, Value> *curr = internalFind(key);
+    Node<Key, Value> *curr = cachedFind(key);
     if(curr == NULL) throw std::out_of_range("Invalid key");
     return curr->getValue();
 }
 template<class Key, class Value>
 Value const & BinarySearchTree<Key, Value>::operator[](const Key& key) const
 {
-    Node<Key, Value> *curr = internalFind(key);
+    Node<Key, Value> *curr = cachedFind(key);
     if(curr == NULL) throw std::out_of_range("Invalid key");
     return curr->getValue();
 }
@@ -523,64 +829,83 @@ Value const & BinarySearchTree<Key, Value>::operator[](const Key& key) const
 template<class Key, class Value>
 void BinarySearchTree<Key, Value>::insert(const std::pair<const Key, Value> &keyValuePair)
 {
-    Key k = keyValuePair.first; //key 
-    Value v = keyValuePair.second; //value 
-    
+    bool created = false;
+    Node<Key, Value>* n = findOrInsert(keyValuePair.first, keyValuePair.second, created);
 
-    //BC1: tree is empty 
-    if (root_==nullptr) {
-        root_ = new Node<Key, Value>(k, v, nullptr);  
-        return;
-    }
-    
-    //BC2: key is already in tree 
-    Node<Key, Value>* item = internalFind(k); //use internal find: if null then key DNE, else it returns ptr to the node with that key 
-    if (item!=nullptr) {  
-
-        //overwrite current value w updated value 
-        item->setValue(v); 
-        return;
-    }
-    //else key is new to the tree -
-    //make new node, parent null for now, and insert it 
-    Node<Key, Value>* n = new Node<Key, Value>(k, v, nullptr); 
-    
-    //walk to correct leaf node
+    //key is already in tree: overwrite current value w updated value
+    if (!created) n->setValue(keyValuePair.second);
+}
 
-    Node<Key, Value>* curr = root_; //ptr curr to hold current position 
-    Node<Key, Value>* parent = nullptr; //ptr to parent 
+/**
+* One descent: returns the node holding k, or links a new node holding
+* (k, v) where the descent ended, sets created and returns that. Balanced
+* trees override this and rebalance, only when a node was created.
+*/
+template<class Key, class Value>
+Node<Key, Value>* BinarySearchTree<Key, Value>::findOrInsert(const Key& k, const Value& v, bool& created)
+{
+    created = false;
+    Node<Key, Value>* curr = root_; //ptr curr to hold current position
+    Node<Key, Value>* parent = nullptr; //ptr to parent
+    size_t depth = 0; //depth the new node will be linked at
 
-    //while the ideal location is taken: 
+    //walk to correct leaf node, unless the key is found on the way
     while (curr!=nullptr) {
-        if (k==curr->getKey()) {
-          curr->setValue(v);
-          return; 
-        }
-        /*inserting new node: 
-        1. compare node to temp  
-        2. if node's key < temp's key -> go to L subtree 
-        3. else go to R subtree 
-        */
-        parent = curr; //child becomes parent 
-
-        if (k<curr->getKey()) {
-            curr = curr->getLeft(); 
-        }
-        else {
-            curr = curr->getRight(); 
-        }
+        parent = curr;
+        if (k<curr->getKey()) curr = curr->getLeft();
+        else if (curr->getKey()<k) curr = curr->getRight();
+        else return curr;
+        ++depth;
     }
 
-    //now we are at the end of the map, either L or R child is nullptr, curr is null 
-    if (k<parent->getKey()) {
-        parent->setLeft(n);
-    }
-    else {
-        parent->setRight(n);
-    }
-    n->setParent(parent); 
-    return; 
-    
+    //now we are at the end of the map, either L or R child is nullptr, curr is null
+    Node<Key, Value>* n = new Node<Key, Value>(k, v, parent);
+    if (parent==nullptr) root_ = n;
+    else if (k<parent->getKey()) parent->setLeft(n);
+    else parent->setRight(n);
+    nodeCreated(n);
+    if (scapegoat_) scapegoatInserted(n, depth);
+    created = true;
+    return n;
+}
+
+/**
+* std::map-style operator[]: the value for key, default-constructed and
+* inserted first if the key is missing. One descent either way.
+*/
+template<class Key, class Value>
+Value& BinarySearchTree<Key, Value>::at_or_insert(const Key& key)
+{
+    bool created = false;
+    return cachedFindOrInsert(key, created)->getValue();
+}
+
+/**
+* Applies fn(Value&) to the value for key in place, inserting a
+* default-constructed value first if the key is missing. One descent.
+* Returns true if the key was inserted.
+*/
+template<class Key, class Value>
+template<class Fn>
+bool BinarySearchTree<Key, Value>::upsert(const Key& key, Fn fn)
+{
+    bool created = false;
+    fn(cachedFindOrInsert(key, created)->getValue());
+    return created;
+}
+
+/**
+* findOrInsert behind the lookup cache: a cache hit skips the descent.
+*/
+template<class Key, class Value>
+Node<Key, Value>* BinarySearchTree<Key, Value>::cachedFindOrInsert(const Key& key, bool& created)
+{
+    created = false;
+    Node<Key, Value>* n = cache_ ? cache_->lookup(key, true) : nullptr;
+    if (n != nullptr) return n;
+    n = findOrInsert(key, Value(), created);
+    if (cache_) cache_->store(key, n);
+    return n;
 }
 
 //my helper function to remove a single node 
@@ -601,6 +926,7 @@ void BinarySearchTree<Key, Value>::removeNode(Node<Key, Value>* n) {
           if (parent->getLeft() == n) parent->setLeft(nullptr);
           else parent->setRight(nullptr);
       }
+      nodeDestroyed(n);
       delete n;
       return;
   }
@@ -616,7 +942,7 @@ void BinarySearchTree<Key, Value>::removeNode(Node<Key, Value>* n) {
       child->setParent(parent);
   }
 
-
+  nodeDestroyed(n);
   delete n;
   return;
 }
@@ -629,14 +955,22 @@ void BinarySearchTree<Key, Value>::removeNode(Node<Key, Value>* n) {
 template<typename Key, typename Value>
 void BinarySearchTree<Key, Value>::remove(const Key& key)
 {
-    //BC 1: empty tree 
-    if (root_==nullptr) return;
+    removeKey(key);
+    if (scapegoat_) scapegoatRemoved();
+}
+
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::removeKey(const Key& key)
+{
+    //BC 1: empty tree (or a key the membership filter rules out)
+    if (root_==nullptr || !mayContain(key)) return;
 
     //find node 
     Node<Key, Value>* n = internalFind(key); 
 
     //BC 2: removing a node that DNE 
     if (n==nullptr) {
+        if (filter_) filter_->falsePositive();
         return;
     }
     
@@ -651,6 +985,7 @@ void BinarySearchTree<Key, Value>::remove(const Key& key)
         //sub sub case: if deleting root 
         if (n==root_) {
             root_=nullptr;
+            nodeDestroyed(n);
             delete n;
             return; 
         }
@@ -665,7 +1000,7 @@ void BinarySearchTree<Key, Value>::remove(const Key& key)
 
        }
 
-
+       nodeDestroyed(n);
        delete n; 
        return; 
     }
@@ -696,6 +1031,7 @@ void BinarySearchTree<Key, Value>::remove(const Key& key)
             parent->setRight(temp);
             temp->setParent(parent);
         }
+        nodeDestroyed(n);
         delete n;
         return; 
 
@@ -806,18 +1142,132 @@ void BinarySearchTree<Key, Value>::clear()
 
     clearSubtrees(root_);
     root_=nullptr; 
+    size_ = 0;
+    if (cache_) cache_->reset();
+    if (filter_) filter_->reset();
+    if (scapegoat_) scapegoat_->reset(0);
     return; 
 }
 
 //my helper function for clear()
+//post-order delete through the parent pointers instead of recursion, so a
+//degenerate (list-shaped) tree cannot overflow the call stack
 template <typename Key, typename Value>
 void BinarySearchTree<Key, Value>::clearSubtrees (Node<Key, Value>* n) {
     //BC: if n=nullptr 
     if (n==nullptr) return; 
-    clearSubtrees(n->getLeft());
-    clearSubtrees(n->getRight());
+    Node<Key, Value>* stop = n->getParent();
+    while (n != stop) {
+        if (n->getLeft() != nullptr) n = n->getLeft();
+        else if (n->getRight() != nullptr) n = n->getRight();
+        else {
+            //leaf: unlink it from its parent, then delete it
+            Node<Key, Value>* parent = n->getParent();
+            if (parent != stop) {
+                if (parent->getLeft() == n) parent->setLeft(nullptr);
+                else parent->setRight(nullptr);
+            }
+            delete n;
+            n = parent;
+        }
+    }
+}
+
+/**
+* Rotates n's right child up into n's place.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::rotateLeft(Node<Key, Value>* n)
+{
+    if (n == nullptr) return;
+    Node<Key, Value>* r = n->getRight();
+    if (r == nullptr) return;
+    Node<Key, Value>* rl = r->getLeft();
+    Node<Key, Value>* parent = n->getParent();
+
+    r->setLeft(n);
+    r->setParent(parent);
+    n->setParent(r);
+    n->setRight(rl);
+    if (rl) rl->setParent(n);
+
+    if (!parent) root_ = r;
+    else if (parent->getLeft() == n) parent->setLeft(r);
+    else parent->setRight(r);
+}
 
-    delete n; 
+/**
+* Rotates n's left child up into n's place.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::rotateRight(Node<Key, Value>* n)
+{
+    if (n == nullptr) return;
+    Node<Key, Value>* l = n->getLeft();
+    if (l == nullptr) return;
+    Node<Key, Value>* lr = l->getRight();
+    Node<Key, Value>* parent = n->getParent();
+
+    l->setRight(n);
+    l->setParent(parent);
+    n->setParent(l);
+    n->setLeft(lr);
+    if (lr) lr->setParent(n);
+
+    if (!parent) root_ = l;
+    else if (parent->getLeft() == n) parent->setLeft(l);
+    else parent->setRight(l);
+}
+
+/**
+* Day-Stout-Warren. Right rotations at every left child turn the tree into
+* a vine, a list hanging off right pointers, without a stack. Then a first
+* compressVine pass leaves exactly the overflow of the last, partial level
+* (count - m, where m = 2^k - 1 is the largest full tree that fits) as
+* leaves, and halving passes fold the remaining m-node vine into a full
+* tree. Every leaf ends at depth h - 1 or h, so siblings' heights differ by
+* at most one.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::rebalance()
+{
+    size_t count = 0;
+    Node<Key, Value>* n = root_;
+    while (n != nullptr) {
+        Node<Key, Value>* l = n->getLeft();
+        if (l != nullptr) {
+            rotateRight(n);
+            n = l;
+        }
+        else {
+            ++count;
+            n = n->getRight();
+        }
+    }
+
+    size_t m = 1;
+    while (m * 2 + 1 <= count) m = m * 2 + 1;
+    if (count > 0) compressVine(count - m);
+    while (m > 1) {
+        m /= 2;
+        compressVine(m);
+    }
+    if (scapegoat_) scapegoat_->reset(size_);
+}
+
+/**
+* Walks down the right spine from the root, rotating every other node
+* down to the left of its successor: count rotations.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::compressVine(size_t count)
+{
+    Node<Key, Value>* n = root_;
+    for (size_t i = 0; i < count; ++i) {
+        Node<Key, Value>* r = n->getRight();
+        rotateLeft(n);
+        n = r->getRight();
+    }
 }
 
 /**
@@ -919,6 +1369,10 @@ void BinarySearchTree<Key, Value>::nodeSwap( Node<Key,Value>* n1, Node<Key,Value
     if((n1 == n2) || (n1 == NULL) || (n2 == NULL) ) {
         return;
     }
+    if (cache_) {
+        cache_->invalidate(n1);
+        cache_->invalidate(n2);
+    }
     Node<Key, Value>* n1p = n1->getParent();
     Node<Key, Value>* n1r = n1->getRight();
     Node<Key, Value>* n1lt = n1->getLeft();
@@ -1013,6 +1467,24 @@ void BinarySearchTree<Key, Value>::nodeSwap( Node<Key,Value>* n1, Node<Key,Value
 // include print function (in its own file because it's fairly long)
 #include "print_bst.h"
 
+// include the shape profiler (same reason)
+#include "bst_shape.h"
+
+// include the streaming DOT/JSON exporter
+#include "bst_export.h"
+
+// include the optional lookup cache
+#include "bst_cache.h"
+
+// include the optional membership filter
+#include "bst_filter.h"
+
+// include the batched, prefetching find
+#include "bst_batch.h"
+
+// include the optional scapegoat rebuilds
+#include "bst_scapegoat.h"
+
 /*
 ---------------------------------------------------
 End implementations for the BinarySearchTree class.
@@ -0,0 +1,174 @@
+#ifndef BST_BATCH_H
+#define BST_BATCH_H
+
+#include <cstddef>
+#include <vector>
+
+// Batched lookups.
+//
+// A single find() in a tree larger than the cache waits for one memory miss
+// per level. find_batch() keeps Lanes descents in flight at once, AMAC style
+// (asynchronous memory access chaining): each lane is a tiny state machine
+// holding its key and current node. The loop advances every lane by one
+// level and prefetches the child it will visit next, then moves on to the
+// next lane, so by the time it comes back that child is (ideally) in cache.
+// A finished lane writes its result and immediately takes the next key.
+//
+// Results are the same as calling find() on each key: the membership
+// filter is consulted, the lookup cache is not.
+//
+// When the keys arrive sorted, find_sorted() / contains_sorted() instead
+// walk the tree once, left to right. The walk keeps a finger on the node
+// where the previous probe ended, plus a stack of the ancestors it went
+// left at: the bounds above the finger, nearest (smallest) on top. The next
+// key pops bounds that are not above it, then descends from the last one
+// popped. In a balanced tree a probe then costs O(log gap) rather than
+// O(log n), and the finger only ever moves left to right. A key smaller
+// than its predecessor restarts from the root, so unsorted input is slower
+// but still answered correctly. KeyIt must be a forward iterator.
+
+#if defined(__GNUC__)
+#define BST_PREFETCH(p) __builtin_prefetch(p)
+#else
+#define BST_PREFETCH(p) ((void)0)
+#endif
+
+/**
+* Looks up every key in [first, last) and writes the matching iterator (or
+* end()) to out[i] for the i-th key. KeyIt and OutIt must be random access.
+*/
+template<typename Key, typename Value>
+template<size_t Lanes, class KeyIt, class OutIt>
+void BinarySearchTree<Key, Value>::find_batch(KeyIt first, KeyIt last, OutIt out) const
+{
+    static_assert(Lanes > 0, "find_batch needs at least one lane");
+    struct Lane
+    {
+        const Key* key;
+        Node<Key, Value>* node;
+        size_t index;
+    };
+    Lane lanes[Lanes];
+
+    const size_t count = size_t(last - first);
+    size_t next = 0;    // next key to hand to a lane
+    size_t active = 0;  // lanes [0, active) hold a lookup
+
+    // hands key i to lane l; false if it was answered without a descent
+    auto start = [&](Lane& l, size_t i) -> bool {
+        l.key = &first[i];
+        l.index = i;
+        if (root_ == nullptr || !mayContain(*l.key)) {
+            out[i] = end();
+            return false;
+        }
+        l.node = root_;
+        BST_PREFETCH(l.node);
+        return true;
+    };
+
+    while (active < Lanes && next < count) {
+        if (start(lanes[active], next++)) ++active;
+    }
+
+    while (active > 0) {
+        for (size_t i = 0; i < active; ) {
+            Lane& l = lanes[i];
+            Node<Key, Value>* n = l.node;
+            Node<Key, Value>* child = nullptr;
+            bool found = false;
+            if (*l.key < n->getKey()) child = n->getLeft();
+            else if (n->getKey() < *l.key) child = n->getRight();
+            else found = true;
+
+            if (child != nullptr) {
+                l.node = child;
+                BST_PREFETCH(child);
+                ++i;
+                continue;
+            }
+            // lane done: write its result, then refill or retire it
+            out[l.index] = found ? iterator(n) : end();
+            bool refilled = false;
+            while (!refilled && next < count) refilled = start(l, next++);
+            if (refilled) ++i;
+            else lanes[i] = lanes[--active];
+        }
+    }
+}
+
+/**
+* Walks the finger described above; visit(n) gets the node holding each key
+* in turn, or nullptr.
+*/
+template<typename Key, typename Value>
+template<class KeyIt, class Visit>
+void BinarySearchTree<Key, Value>::sortedWalk(KeyIt first, KeyIt last, Visit visit) const
+{
+    std::vector<Node<Key, Value>*> bounds; // ancestors we went left at
+    Node<Key, Value>* finger = root_;
+    const Key* prev = nullptr;
+
+    for (; first != last; ++first) {
+        const Key& key = *first;
+        if (root_ == nullptr || !mayContain(key)) {
+            visit(static_cast<Node<Key, Value>*>(nullptr));
+            continue;
+        }
+        if (prev != nullptr && key < *prev) {
+            // out of order: start over from the root
+            bounds.clear();
+            finger = root_;
+        }
+        prev = &key;
+
+        // climb to the lowest subtree whose key range can hold key
+        while (!bounds.empty() && !(key < bounds.back()->getKey())) {
+            finger = bounds.back();
+            bounds.pop_back();
+        }
+
+        Node<Key, Value>* n = finger;
+        Node<Key, Value>* hit = nullptr;
+        while (n != nullptr) {
+            finger = n;
+            if (key < n->getKey()) {
+                bounds.push_back(n);
+                n = n->getLeft();
+            }
+            else if (n->getKey() < key) n = n->getRight();
+            else {
+                hit = n;
+                break;
+            }
+        }
+        // a miss ends on a leaf-ish node pushed as its own bound: drop it so
+        // the finger is not above itself
+        if (hit == nullptr && !bounds.empty() && bounds.back() == finger) bounds.pop_back();
+        visit(hit);
+    }
+}
+
+/**
+* Writes find(key) to *out++ for every key in [first, last), which should
+* be sorted ascending.
+*/
+template<typename Key, typename Value>
+template<class KeyIt, class OutIt>
+void BinarySearchTree<Key, Value>::find_sorted(KeyIt first, KeyIt last, OutIt out) const
+{
+    sortedWalk(first, last, [&](Node<Key, Value>* n) { *out++ = n ? iterator(n) : end(); });
+}
+
+/**
+* Writes whether each key in [first, last), which should be sorted
+* ascending, is in the tree to *out++.
+*/
+template<typename Key, typename Value>
+template<class KeyIt, class OutIt>
+void BinarySearchTree<Key, Value>::contains_sorted(KeyIt first, KeyIt last, OutIt out) const
+{
+    sortedWalk(first, last, [&](Node<Key, Value>* n) { *out++ = (n != nullptr); });
+}
+
+#endif
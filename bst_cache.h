@@ -0,0 +1,250 @@
+#ifndef BST_CACHE_H
+#define BST_CACHE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Optional hot-key lookup cache for BinarySearchTree.
+//
+// enableLookupCache(sets) puts a small 2-way set-associative table in front
+// of find() and operator[]. It maps std::hash<Key> of recently found keys to
+// their Node*, so a repeated lookup costs one hash, one table line and the
+// node itself instead of an O(log n) descent. Misses are not cached.
+//
+// A Node* stays valid while its node is in the tree (rotations and
+// nodeSwap move nodes, not keys), so entries only go stale when a node is
+// deleted: every path that deletes a node calls nodeDestroyed() first, and
+// clear() empties the table. nodeSwap() drops both nodes as well, to be safe
+// for subclasses that swap contents rather than links.
+//
+// The table calls the hash through a function pointer that only
+// enableLookupCache() takes, so a tree whose key type has no std::hash
+// compiles as long as it never enables the cache.
+//
+// find() and operator[] const may run in several threads at once, as
+// without the cache: on that path the table's entries and the hit/miss
+// counters are relaxed atomics, and a hit in way 1 is not promoted. A
+// thread may pair one thread's hash with another's node, but every hit
+// compares the key, so the worst case is a miss. Counter updates are a
+// load and a store rather than a locked add, so concurrent lookups may
+// lose some counts. Inserts and removes still need the tree to themselves.
+
+/**
+ * Hit/miss counters of the lookup cache.
+ */
+struct LookupCacheStats
+{
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t invalidations;  // entries dropped for removed / swapped nodes
+    size_t sets;             // 0 when the cache is disabled
+    size_t bytes;            // table memory
+
+    LookupCacheStats() : hits(0), misses(0), invalidations(0), sets(0), bytes(0) {}
+
+    double hitRate() const
+    {
+        return hits + misses ? double(hits) / double(hits + misses) : 0.0;
+    }
+
+    std::string toJSON() const
+    {
+        std::ostringstream os;
+        os << "{\"hits\": " << hits << ", \"misses\": " << misses
+           << ", \"hit_rate\": " << hitRate() << ", \"invalidations\": " << invalidations
+           << ", \"sets\": " << sets << ", \"bytes\": " << bytes << "}";
+        return os.str();
+    }
+};
+
+/**
+ * 2-way set-associative map from key hash to node. Way 0 of a set is the
+ * most recently used one, as far as the non-const lookups tell.
+ */
+template<typename Key, typename Value>
+class BSTLookupCache
+{
+public:
+    typedef size_t (*HashFn)(const Key&);
+
+    // std::hash<Key>, instantiated only where its address is taken
+    static size_t stdHash(const Key& key) { return std::hash<Key>()(key); }
+
+    // sets is rounded up to a power of two
+    BSTLookupCache(size_t sets, HashFn hash) :
+        sets_(roundUp(sets)), mask_(sets_.size() - 1), hasher_(hash), hits_(0), misses_(0)
+    {
+    }
+
+    // promote moves a way-1 hit to way 0; only the non-const lookups ask,
+    // as it reorders the set under any other thread reading it
+    Node<Key, Value>* lookup(const Key& key, bool promote)
+    {
+        size_t h = hasher_(key);
+        Set& s = sets_[h & mask_];
+        for (int w = 0; w < 2; ++w) {
+            Node<Key, Value>* n = s.node[w].load(std::memory_order_relaxed);
+            if (n != nullptr && s.hash[w].load(std::memory_order_relaxed) == h && n->getKey() == key) {
+                if (w == 1 && promote) s.promote();
+                bump(hits_);
+                return n;
+            }
+        }
+        bump(misses_);
+        return nullptr;
+    }
+
+    void store(const Key& key, Node<Key, Value>* n)
+    {
+        size_t h = hasher_(key);
+        Set& s = sets_[h & mask_];
+        s.hash[1].store(s.hash[0].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        s.node[1].store(s.node[0].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        s.hash[0].store(h, std::memory_order_relaxed);
+        s.node[0].store(n, std::memory_order_relaxed);
+    }
+
+    // drops n if it is cached
+    void invalidate(const Node<Key, Value>* n)
+    {
+        Set& s = sets_[hasher_(n->getKey()) & mask_];
+        for (int w = 0; w < 2; ++w) {
+            if (s.node[w].load(std::memory_order_relaxed) == n) {
+                s.node[w].store(nullptr, std::memory_order_relaxed);
+                ++stats_.invalidations;
+            }
+        }
+    }
+
+    void reset()
+    {
+        for (size_t i = 0; i < sets_.size(); ++i) sets_[i].clear();
+    }
+
+    LookupCacheStats stats() const
+    {
+        LookupCacheStats s = stats_;
+        s.hits = hits_.load(std::memory_order_relaxed);
+        s.misses = misses_.load(std::memory_order_relaxed);
+        s.sets = sets_.size();
+        s.bytes = sets_.size() * sizeof(Set);
+        return s;
+    }
+
+    void resetStats()
+    {
+        stats_ = LookupCacheStats();
+        hits_.store(0, std::memory_order_relaxed);
+        misses_.store(0, std::memory_order_relaxed);
+    }
+
+    HashFn hashFunction() const { return hasher_; }
+
+private:
+    struct Set
+    {
+        std::atomic<size_t> hash[2];
+        std::atomic<Node<Key, Value>*> node[2];
+
+        Set() { clear(); }
+        void clear()
+        {
+            for (int w = 0; w < 2; ++w) {
+                hash[w].store(0, std::memory_order_relaxed);
+                node[w].store(nullptr, std::memory_order_relaxed);
+            }
+        }
+        void promote()
+        {
+            size_t h = hash[0].load(std::memory_order_relaxed);
+            Node<Key, Value>* n = node[0].load(std::memory_order_relaxed);
+            hash[0].store(hash[1].load(std::memory_order_relaxed), std::memory_order_relaxed);
+            node[0].store(node[1].load(std::memory_order_relaxed), std::memory_order_relaxed);
+            hash[1].store(h, std::memory_order_relaxed);
+            node[1].store(n, std::memory_order_relaxed);
+        }
+    };
+
+    static size_t roundUp(size_t sets)
+    {
+        size_t n = 1;
+        while (n < sets) n <<= 1;
+        return n;
+    }
+
+    // no locked add: concurrent lookups may lose a count, not corrupt one
+    static void bump(std::atomic<uint64_t>& c)
+    {
+        c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    std::vector<Set> sets_;
+    size_t mask_;
+    HashFn hasher_;
+    LookupCacheStats stats_;         // invalidations, counted by writers only
+    std::atomic<uint64_t> hits_;     // counted by const lookups
+    std::atomic<uint64_t> misses_;
+};
+
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::enableLookupCache(size_t sets)
+{
+    delete cache_;
+    cache_ = new BSTLookupCache<Key, Value>(sets == 0 ? 1 : sets, &BSTLookupCache<Key, Value>::stdHash);
+}
+
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::disableLookupCache()
+{
+    delete cache_;
+    cache_ = nullptr;
+}
+
+template<typename Key, typename Value>
+LookupCacheStats BinarySearchTree<Key, Value>::lookupCacheStats() const
+{
+    return cache_ ? cache_->stats() : LookupCacheStats();
+}
+
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::resetLookupCacheStats()
+{
+    if (cache_) cache_->resetStats();
+}
+
+/**
+* internalFind behind the membership filter (bst_filter.h) and the lookup
+* cache, each when enabled.
+*/
+template<typename Key, typename Value>
+Node<Key, Value>* BinarySearchTree<Key, Value>::cachedFind(const Key& key) const
+{
+    if (filter_ != nullptr && !filter_->mayContain(key)) return nullptr;
+    Node<Key, Value>* n = cache_ ? cache_->lookup(key, false) : nullptr;
+    if (n != nullptr) return n;
+    n = internalFind(key);
+    if (n == nullptr) {
+        if (filter_) filter_->falsePositive();
+    }
+    else if (cache_) cache_->store(key, n);
+    return n;
+}
+
+/**
+* Must be called before a node is deleted from the tree.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::nodeDestroyed(Node<Key, Value>* n)
+{
+    --size_;
+    if (cache_) cache_->invalidate(n);
+    if (filter_) filter_->remove(n->getKey());
+}
+
+#endif
@@ -0,0 +1,185 @@
+#ifndef BST_EXPORT_H
+#define BST_EXPORT_H
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+// Streaming tree exporter.
+//
+// printRoot() only draws the top PPBST_MAX_HEIGHT levels and is meant for a
+// terminal. exportTree()/exportSubtree() write the real shape of a tree of
+// any size as Graphviz DOT or as JSON, one node at a time, walking the tree
+// iteratively through the parent pointers: O(n) time and O(1) memory.
+//
+// Modes (TreeExportOptions):
+//   - subtree:  exportSubtree(os, key) starts at the node holding key
+//   - depth:    maxDepth stops the walk that many levels below the start
+//   - sampled:  sampleEvery = k keeps about one node in k, chosen by a hash
+//               of the node address so the choice is stable across calls;
+//               an edge is written only when both ends are kept, and JSON
+//               records always name the real parent
+// AVLTree nodes are annotated with their balance tag (the rank for WAVLTree).
+
+// Writes v as a quoted, escaped string (valid in both DOT and JSON).
+template<typename T>
+void bstExportQuoted(std::ostream& os, const T& v)
+{
+    std::ostringstream tmp;
+    tmp << v;
+    const std::string s = tmp.str();
+    static const char hex[] = "0123456789abcdef";
+    os << '"';
+    for (size_t i = 0; i < s.size(); ++i) {
+        unsigned char c = static_cast<unsigned char>(s[i]);
+        if (c == '"' || c == '\\') os << '\\' << char(c);
+        else if (c == '\n') os << "\\n";
+        else if (c < 0x20) os << "\\u00" << hex[c >> 4] << hex[c & 0xf];
+        else os << char(c);
+    }
+    os << '"';
+}
+
+// Writes a node id ("n" followed by the node address in hex).
+inline void bstExportId(std::ostream& os, const void* p)
+{
+    char buf[2 + 2 * sizeof(uintptr_t)];
+    size_t i = sizeof(buf);
+    buf[--i] = '\0';
+    uintptr_t v = reinterpret_cast<uintptr_t>(p);
+    do {
+        buf[--i] = "0123456789abcdef"[v & 0xf];
+        v >>= 4;
+    } while (v != 0);
+    buf[--i] = 'n';
+    os << (buf + i);
+}
+
+// Stable pseudo-random choice of about one node in every.
+inline bool bstExportSampled(const void* p, size_t every)
+{
+    if (every <= 1) return true;
+    uint64_t x = uint64_t(reinterpret_cast<uintptr_t>(p));
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x % every == 0;
+}
+
+template<typename Key, typename Value>
+bool BinarySearchTree<Key, Value>::nodeBalance(const Node<Key, Value>*, int&) const
+{
+    return false;
+}
+
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::exportTree(std::ostream& os, const TreeExportOptions& opts) const
+{
+    exportFrom(os, root_, opts);
+}
+
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::exportSubtree(std::ostream& os, const Key& key,
+                                                 const TreeExportOptions& opts) const
+{
+    exportFrom(os, internalFind(key), opts);
+}
+
+/**
+* Pre-order walk from start using parent pointers. prev tells us where we
+* came from: the parent (first visit), the left child, or the right child.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::exportFrom(std::ostream& os, Node<Key, Value>* start,
+                                              const TreeExportOptions& opts) const
+{
+    const bool dot = (opts.format == TreeExportOptions::DOT);
+    if (dot) os << "digraph BST {\n  node [shape=box];\n";
+    else os << "{\"nodes\": [";
+
+    bool firstRecord = true;
+    Node<Key, Value>* curr = start;
+    Node<Key, Value>* prev = start ? start->getParent() : nullptr;
+    int depth = 0;
+
+    while (curr != nullptr) {
+        Node<Key, Value>* parent = curr->getParent();
+        Node<Key, Value>* left = curr->getLeft();
+        Node<Key, Value>* right = curr->getRight();
+        bool canDescend = (opts.maxDepth < 0 || depth < opts.maxDepth);
+
+        if (prev == parent) {
+            //first visit: write the node
+            if (curr == start || bstExportSampled(curr, opts.sampleEvery)) {
+                int balance = 0;
+                bool hasBalance = nodeBalance(curr, balance);
+                bool isRoot = (curr == start);
+                const char* side = isRoot ? nullptr : (parent->getLeft() == curr ? "L" : "R");
+
+                if (dot) {
+                    os << "  ";
+                    bstExportId(os, curr);
+                    std::ostringstream label;
+                    label << curr->getKey();
+                    if (opts.withValues) label << "\n" << curr->getValue();
+                    if (hasBalance) label << "\nb=" << balance;
+                    os << " [label=";
+                    bstExportQuoted(os, label.str());
+                    os << "];\n";
+                    if (!isRoot && (parent == start || bstExportSampled(parent, opts.sampleEvery))) {
+                        os << "  ";
+                        bstExportId(os, parent);
+                        os << " -> ";
+                        bstExportId(os, curr);
+                        os << " [label=\"" << side << "\"];\n";
+                    }
+                }
+                else {
+                    os << (firstRecord ? "\n" : ",\n") << "  {\"id\": \"";
+                    bstExportId(os, curr);
+                    os << "\", \"parent\": ";
+                    if (isRoot) os << "null, \"side\": null";
+                    else {
+                        os << '"';
+                        bstExportId(os, parent);
+                        os << "\", \"side\": \"" << side << '"';
+                    }
+                    os << ", \"depth\": " << depth << ", \"key\": ";
+                    bstExportQuoted(os, curr->getKey());
+                    if (opts.withValues) {
+                        os << ", \"value\": ";
+                        bstExportQuoted(os, curr->getValue());
+                    }
+                    if (hasBalance) os << ", \"balance\": " << balance;
+                    os << '}';
+                }
+                firstRecord = false;
+            }
+            if (left != nullptr && canDescend) {
+                prev = curr;
+                curr = left;
+                ++depth;
+                continue;
+            }
+        }
+        //left side done: go right
+        if (right != nullptr && prev != right && canDescend) {
+            prev = curr;
+            curr = right;
+            ++depth;
+            continue;
+        }
+        //both sides done: go up, unless this was the start node
+        if (curr == start) break;
+        prev = curr;
+        curr = parent;
+        --depth;
+    }
+
+    if (dot) os << "}\n";
+    else os << (firstRecord ? "]}\n" : "\n]}\n");
+}
+
+#endif
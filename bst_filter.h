@@ -0,0 +1,294 @@
+#ifndef BST_FILTER_H
+#define BST_FILTER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Optional membership filter for BinarySearchTree.
+//
+// enableMembershipFilter(expectedKeys) adds a blocked counting Bloom filter
+// that every insert adds the new key to and every remove takes it out of.
+// find(), operator[] and remove() ask it first, so a key that was never
+// inserted is usually rejected without a descent.
+//
+// Each key maps to one 64-byte block of 128 four-bit counters (one or two
+// cache lines, depending on the allocation's alignment) and sets 4 of them.
+// The table gets at least 12 counters (6 bytes) per expected key, rounded
+// up to a power of two blocks, for a false-positive rate of about 1% or
+// less. When an insert takes the tree past the filter's expected key count,
+// the filter is rebuilt from the tree's keys for twice its size: O(n), but
+// only after n/2 inserts since the last rebuild. A counter that reaches 15
+// sticks there, so deletes can never cause a false negative.
+//
+// As with the lookup cache, std::hash<Key> is reached through a function
+// pointer that enableMembershipFilter() supplies, so keys without a hash
+// only fail to compile when the filter is actually enabled.
+//
+// Const lookups only read the counters table, so several threads may still
+// call find() and operator[] const at once. The queries / rejected /
+// false-positive counts they keep are relaxed atomics, updated with a load
+// and a store like the lookup cache's, so concurrent lookups may lose a
+// few counts.
+
+/**
+ * Counters of the membership filter.
+ */
+struct MembershipFilterStats
+{
+    uint64_t queries;         // lookups that asked the filter
+    uint64_t rejected;        // answered "absent" without a descent
+    uint64_t falsePositives;  // passed the filter but the key was absent
+    uint64_t saturated;       // counters stuck at their maximum
+    uint64_t grows;           // rebuilds at a larger size
+    size_t expectedKeys;      // keys the table is currently sized for
+    size_t bytes;             // counter memory, 0 when the filter is disabled
+
+    MembershipFilterStats() :
+        queries(0), rejected(0), falsePositives(0), saturated(0), grows(0), expectedKeys(0), bytes(0)
+    {
+    }
+
+    // share of absent keys the filter failed to reject
+    double falsePositiveRate() const
+    {
+        return rejected + falsePositives ? double(falsePositives) / double(rejected + falsePositives) : 0.0;
+    }
+
+    std::string toJSON() const
+    {
+        std::ostringstream os;
+        os << "{\"queries\": " << queries << ", \"rejected\": " << rejected
+           << ", \"false_positives\": " << falsePositives
+           << ", \"false_positive_rate\": " << falsePositiveRate()
+           << ", \"saturated_counters\": " << saturated << ", \"grows\": " << grows
+           << ", \"expected_keys\": " << expectedKeys << ", \"bytes\": " << bytes << "}";
+        return os.str();
+    }
+};
+
+/**
+ * Blocked counting Bloom filter over std::hash<Key>.
+ */
+template<typename Key>
+class BSTMembershipFilter
+{
+public:
+    static const int COUNTERS_PER_KEY = 12;
+    static const int PROBES = 4;
+    static const size_t WORDS_PER_BLOCK = 8;   // 8 x 64 bits = 128 counters
+
+    typedef size_t (*HashFn)(const Key&);
+
+    // std::hash<Key>, instantiated only where its address is taken
+    static size_t stdHash(const Key& key) { return std::hash<Key>()(key); }
+
+    BSTMembershipFilter(size_t expectedKeys, HashFn hash) :
+        expectedKeys_(expectedKeys == 0 ? 1 : expectedKeys), hasher_(hash),
+        queries_(0), rejected_(0), falsePositives_(0)
+    {
+        size_t counters = expectedKeys_ * COUNTERS_PER_KEY;
+        size_t blocks = 1;
+        while (blocks * WORDS_PER_BLOCK * 16 < counters) blocks <<= 1;
+        words_.assign(blocks * WORDS_PER_BLOCK, 0);
+        blockMask_ = blocks - 1;
+    }
+
+    BSTMembershipFilter(const BSTMembershipFilter& other) :
+        words_(other.words_), blockMask_(other.blockMask_), expectedKeys_(other.expectedKeys_),
+        stats_(other.stats_), hasher_(other.hasher_),
+        queries_(other.queries_.load(std::memory_order_relaxed)),
+        rejected_(other.rejected_.load(std::memory_order_relaxed)),
+        falsePositives_(other.falsePositives_.load(std::memory_order_relaxed))
+    {
+    }
+    BSTMembershipFilter& operator=(const BSTMembershipFilter&) = delete;
+
+    void add(const Key& key)
+    {
+        uint64_t h = hashOf(key);
+        uint64_t* block = blockOf(h);
+        for (int i = 0; i < PROBES; ++i) {
+            unsigned pos = unsigned(h >> (7 * i)) & 127;
+            uint64_t& w = block[pos >> 4];
+            unsigned shift = (pos & 15) * 4;
+            uint64_t c = (w >> shift) & 0xf;
+            if (c < 15) {
+                w += uint64_t(1) << shift;
+                if (c + 1 == 15) ++stats_.saturated;
+            }
+        }
+    }
+
+    void remove(const Key& key)
+    {
+        uint64_t h = hashOf(key);
+        uint64_t* block = blockOf(h);
+        for (int i = 0; i < PROBES; ++i) {
+            unsigned pos = unsigned(h >> (7 * i)) & 127;
+            uint64_t& w = block[pos >> 4];
+            unsigned shift = (pos & 15) * 4;
+            uint64_t c = (w >> shift) & 0xf;
+            if (c > 0 && c < 15) w -= uint64_t(1) << shift;
+        }
+    }
+
+    // false means key is certainly absent
+    bool mayContain(const Key& key)
+    {
+        bump(queries_);
+        uint64_t h = hashOf(key);
+        const uint64_t* block = blockOf(h);
+        for (int i = 0; i < PROBES; ++i) {
+            unsigned pos = unsigned(h >> (7 * i)) & 127;
+            if (((block[pos >> 4] >> ((pos & 15) * 4)) & 0xf) == 0) {
+                bump(rejected_);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // the key passed mayContain() but the tree does not hold it
+    void falsePositive() { bump(falsePositives_); }
+
+    void reset()
+    {
+        words_.assign(words_.size(), 0);
+        stats_.saturated = 0;
+    }
+
+    // takes over the counters of the filter this one replaces
+    void grewFrom(const BSTMembershipFilter& old)
+    {
+        stats_.grows = old.stats_.grows + 1;
+        queries_.store(old.queries_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        rejected_.store(old.rejected_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        falsePositives_.store(old.falsePositives_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+
+    size_t expectedKeys() const { return expectedKeys_; }
+    HashFn hashFunction() const { return hasher_; }
+
+    MembershipFilterStats stats() const
+    {
+        MembershipFilterStats s = stats_;
+        s.queries = queries_.load(std::memory_order_relaxed);
+        s.rejected = rejected_.load(std::memory_order_relaxed);
+        s.falsePositives = falsePositives_.load(std::memory_order_relaxed);
+        s.expectedKeys = expectedKeys_;
+        s.bytes = words_.size() * sizeof(uint64_t);
+        return s;
+    }
+
+    void resetStats()
+    {
+        uint64_t saturated = stats_.saturated;
+        stats_ = MembershipFilterStats();
+        stats_.saturated = saturated;
+        queries_.store(0, std::memory_order_relaxed);
+        rejected_.store(0, std::memory_order_relaxed);
+        falsePositives_.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    // std::hash is the identity for integers, so mix it (MurmurHash3 fmix64)
+    uint64_t hashOf(const Key& key) const
+    {
+        uint64_t x = uint64_t(hasher_(key));
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        x *= 0xc4ceb9fe1a85ec53ULL;
+        x ^= x >> 33;
+        return x;
+    }
+
+    // block from the high bits, counter positions from the low 28
+    uint64_t* blockOf(uint64_t h) { return &words_[((h >> 32) & blockMask_) * WORDS_PER_BLOCK]; }
+
+    // no locked add: concurrent lookups may lose a count, not corrupt one
+    static void bump(std::atomic<uint64_t>& c)
+    {
+        c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    std::vector<uint64_t> words_;
+    uint64_t blockMask_;
+    size_t expectedKeys_;
+    MembershipFilterStats stats_;      // saturated and grows, kept by writers
+    HashFn hasher_;
+    std::atomic<uint64_t> queries_;    // counted by const lookups
+    std::atomic<uint64_t> rejected_;
+    std::atomic<uint64_t> falsePositives_;
+};
+
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::enableMembershipFilter(size_t expectedKeys)
+{
+    delete filter_;
+    if (expectedKeys < size_) expectedKeys = size_;
+    filter_ = new BSTMembershipFilter<Key>(expectedKeys, &BSTMembershipFilter<Key>::stdHash);
+    for (iterator it = begin(); it != end(); ++it) filter_->add(it->first);
+}
+
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::disableMembershipFilter()
+{
+    delete filter_;
+    filter_ = nullptr;
+}
+
+template<typename Key, typename Value>
+MembershipFilterStats BinarySearchTree<Key, Value>::membershipFilterStats() const
+{
+    return filter_ ? filter_->stats() : MembershipFilterStats();
+}
+
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::resetMembershipFilterStats()
+{
+    if (filter_) filter_->resetStats();
+}
+
+/**
+* False if the membership filter proves key is absent.
+*/
+template<typename Key, typename Value>
+bool BinarySearchTree<Key, Value>::mayContain(const Key& key) const
+{
+    return filter_ == nullptr || filter_->mayContain(key);
+}
+
+/**
+* Must be called after a new node is linked into the tree.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::nodeCreated(Node<Key, Value>* n)
+{
+    ++size_;
+    if (filter_) {
+        filter_->add(n->getKey());
+        if (size_ > filter_->expectedKeys()) growMembershipFilter();
+    }
+}
+
+/**
+* Replaces the filter with one sized for twice the current key count,
+* filled from the tree. Its counters carry over.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::growMembershipFilter()
+{
+    BSTMembershipFilter<Key>* grown = new BSTMembershipFilter<Key>(2 * size_, filter_->hashFunction());
+    for (iterator it = begin(); it != end(); ++it) grown->add(it->first);
+    grown->grewFrom(*filter_);
+    delete filter_;
+    filter_ = grown;
+}
+
+#endif
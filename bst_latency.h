@@ -0,0 +1,285 @@
+#ifndef BST_LATENCY_H
+#define BST_LATENCY_H
+
+#include <iostream>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/*
+  Opt-in latency histograms for BinarySearchTree / AVLTree.
+
+  TimedTree<Tree> wraps a tree and records how long insert, remove, find
+  and operator[] take into log-bucketed (HDR-style) histograms. Timing can
+  be sampled (every 2^k-th call per operation) to keep the overhead low
+  enough for production builds. Histograms from different threads' trees
+  are combined with LatencyHistogram::merge().
+*/
+
+/**
+ * Log-linear histogram of nanosecond values. Values below 32 are exact;
+ * above that each power of two is split into 32 sub-buckets, so any
+ * reported percentile is within ~3% of the true value.
+ */
+class LatencyHistogram
+{
+public:
+    static const int SUB_BITS = 5;
+    static const int SUB_COUNT = 1 << SUB_BITS;
+    static const int BUCKETS = (64 - SUB_BITS + 1) * SUB_COUNT;
+
+    LatencyHistogram() { reset(); }
+
+    void reset()
+    {
+        std::memset(counts_, 0, sizeof(counts_));
+        count_ = 0;
+        sum_ = 0;
+        min_ = UINT64_MAX;
+        max_ = 0;
+    }
+
+    void record(uint64_t ns)
+    {
+        ++counts_[bucketOf(ns)];
+        ++count_;
+        sum_ += ns;
+        if (ns < min_) min_ = ns;
+        if (ns > max_) max_ = ns;
+    }
+
+    // adds other's samples into this one
+    void merge(const LatencyHistogram& other)
+    {
+        for (int i = 0; i < BUCKETS; ++i) counts_[i] += other.counts_[i];
+        count_ += other.count_;
+        sum_ += other.sum_;
+        if (other.min_ < min_) min_ = other.min_;
+        if (other.max_ > max_) max_ = other.max_;
+    }
+
+    uint64_t count() const { return count_; }
+    uint64_t min() const { return count_ ? min_ : 0; }
+    uint64_t max() const { return max_; }
+    double mean() const { return count_ ? double(sum_) / double(count_) : 0.0; }
+
+    /**
+     * Value at quantile q in [0, 1], as the upper edge of its bucket
+     * (clamped to the largest recorded value).
+     */
+    uint64_t percentile(double q) const
+    {
+        if (count_ == 0) return 0;
+        if (q < 0) q = 0;
+        if (q > 1) q = 1;
+        uint64_t rank = uint64_t(q * double(count_ - 1)) + 1;
+        uint64_t seen = 0;
+        for (int i = 0; i < BUCKETS; ++i) {
+            seen += counts_[i];
+            if (seen >= rank) {
+                uint64_t hi = bucketHigh(i);
+                return hi < max_ ? hi : max_;
+            }
+        }
+        return max_;
+    }
+
+    // one line: count, mean, p50, p90, p99, p999, max (all ns)
+    void print(std::ostream& os) const
+    {
+        os << "count=" << count() << " mean=" << uint64_t(mean()) << " p50=" << percentile(0.50)
+           << " p90=" << percentile(0.90) << " p99=" << percentile(0.99)
+           << " p999=" << percentile(0.999) << " max=" << max();
+    }
+
+private:
+    static int msb(uint64_t v)
+    {
+        int m = 0;
+        while (v >>= 1) ++m;
+        return m;
+    }
+
+    static int bucketOf(uint64_t v)
+    {
+        if (v < uint64_t(SUB_COUNT)) return int(v);
+#if defined(__GNUC__)
+        int m = 63 - __builtin_clzll(v);
+#else
+        int m = msb(v);
+#endif
+        int shift = m - SUB_BITS;
+        return (shift + 1) * SUB_COUNT + int((v >> shift) & (SUB_COUNT - 1));
+    }
+
+    static uint64_t bucketHigh(int idx)
+    {
+        if (idx < SUB_COUNT) return uint64_t(idx);
+        int shift = idx / SUB_COUNT - 1;
+        uint64_t sub = uint64_t(idx % SUB_COUNT);
+        uint64_t low = ((uint64_t(SUB_COUNT) | sub) << shift);
+        return low + ((uint64_t(1) << shift) - 1);
+    }
+
+    uint64_t counts_[BUCKETS];
+    uint64_t count_;
+    uint64_t sum_;
+    uint64_t min_;
+    uint64_t max_;
+};
+
+inline std::ostream& operator<<(std::ostream& os, const LatencyHistogram& h)
+{
+    h.print(os);
+    return os;
+}
+
+/**
+ * Clock source reading std::chrono::steady_clock, in nanoseconds.
+ */
+struct SteadyLatencyClock
+{
+    static uint64_t now()
+    {
+        return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+    static double nsPerTick() { return 1.0; }
+};
+
+#if defined(__x86_64__) || defined(__i386__)
+/**
+ * Clock source reading the TSC. Cheaper than steady_clock; calibrated once
+ * against steady_clock. Assumes an invariant TSC.
+ */
+struct TscLatencyClock
+{
+    static uint64_t now() { return __rdtsc(); }
+    static double nsPerTick()
+    {
+        static const double ratio = calibrate();
+        return ratio;
+    }
+
+private:
+    static double calibrate()
+    {
+        uint64_t t0 = SteadyLatencyClock::now();
+        uint64_t c0 = __rdtsc();
+        while (SteadyLatencyClock::now() - t0 < 10000000) {
+        }
+        uint64_t t1 = SteadyLatencyClock::now();
+        uint64_t c1 = __rdtsc();
+        return c1 > c0 ? double(t1 - t0) / double(c1 - c0) : 1.0;
+    }
+};
+#endif
+
+/**
+ * Wraps a tree and records per-operation latency histograms.
+ * sampleShift = k times one call in 2^k of each operation (0 = every call).
+ */
+template<class Tree, class Clock = SteadyLatencyClock>
+class TimedTree
+{
+public:
+    enum Op { INSERT, REMOVE, FIND, INDEX, OP_COUNT };
+
+    typedef typename Tree::iterator iterator;
+
+    explicit TimedTree(unsigned sampleShift = 0) :
+        mask_((uint64_t(1) << sampleShift) - 1)
+    {
+        for (int i = 0; i < OP_COUNT; ++i) calls_[i] = 0;
+        Clock::nsPerTick();
+    }
+
+    template<class Pair>
+    void insert(const Pair& keyValuePair)
+    {
+        Sample s(*this, INSERT);
+        tree_.insert(keyValuePair);
+    }
+
+    template<class Key>
+    void remove(const Key& key)
+    {
+        Sample s(*this, REMOVE);
+        tree_.remove(key);
+    }
+
+    template<class Key>
+    iterator find(const Key& key) const
+    {
+        Sample s(*this, FIND);
+        return tree_.find(key);
+    }
+
+    // still throws std::out_of_range on a missing key; the call is timed anyway
+    template<class Key>
+    auto operator[](const Key& key) -> decltype(std::declval<Tree&>()[key])
+    {
+        Sample s(*this, INDEX);
+        return tree_[key];
+    }
+
+    iterator begin() const { return tree_.begin(); }
+    iterator end() const { return tree_.end(); }
+
+    Tree& tree() { return tree_; }
+    const Tree& tree() const { return tree_; }
+
+    const LatencyHistogram& latency(Op op) const { return hist_[op]; }
+
+    // folds another wrapper's histograms (e.g. another thread's) into this one
+    void mergeLatency(const TimedTree& other)
+    {
+        for (int i = 0; i < OP_COUNT; ++i) hist_[i].merge(other.hist_[i]);
+    }
+
+    void resetLatency()
+    {
+        for (int i = 0; i < OP_COUNT; ++i) hist_[i].reset();
+    }
+
+    void printLatency(std::ostream& os) const
+    {
+        static const char* const names[OP_COUNT] = { "insert", "remove", "find", "operator[]" };
+        for (int i = 0; i < OP_COUNT; ++i) {
+            os << names[i] << ": " << hist_[i] << "\n";
+        }
+    }
+
+private:
+    // times the enclosing call if it is a sampled one, including on throw
+    struct Sample
+    {
+        Sample(const TimedTree& t, Op op) : tree(t), op(op), start(0)
+        {
+            sampled = ((t.calls_[op]++ & t.mask_) == 0);
+            if (sampled) start = Clock::now();
+        }
+        ~Sample()
+        {
+            if (sampled) {
+                uint64_t ticks = Clock::now() - start;
+                tree.hist_[op].record(uint64_t(double(ticks) * Clock::nsPerTick()));
+            }
+        }
+        const TimedTree& tree;
+        Op op;
+        bool sampled;
+        uint64_t start;
+    };
+
+    Tree tree_;
+    uint64_t mask_;
+    mutable uint64_t calls_[OP_COUNT];
+    mutable LatencyHistogram hist_[OP_COUNT];
+};
+
+#endif
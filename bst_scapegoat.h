@@ -0,0 +1,236 @@
+#ifndef BST_SCAPEGOAT_H
+#define BST_SCAPEGOAT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Optional scapegoat rebuilding for the plain BinarySearchTree.
+//
+// enableScapegoat(alpha) bounds the tree's height by log_{1/alpha}(n)
+// (alpha = 2/3 gives log_{3/2}(n), about 1.71 log2 n) without any per-node
+// balance data, after Galperin and Rivest. An insert counts its depth on the
+// way down; if the new node lands deeper than the bound, the walk back up
+// finds the nearest ancestor whose child on that path holds more than
+// alpha of its subtree (the scapegoat, which must exist), and that subtree
+// is rebuilt perfectly balanced. A remove that leaves the tree smaller than
+// alpha times its size at the last full rebuild rebuilds the whole tree.
+// Both cost O(size of the rebuilt subtree), which amortizes to O(log n) per
+// update.
+//
+// Rebuilding relinks the existing nodes, so iterators to other keys and the
+// lookup cache's Node* entries stay valid. AVLTree and SplayTree balance
+// themselves and ignore the setting. Inserts into a tree that was already
+// deep when the policy was enabled only repair the paths they take.
+
+/**
+ * Counters of the scapegoat policy.
+ */
+struct ScapegoatStats
+{
+    uint64_t rebuilds;      // subtree rebuilds after a deep insert
+    uint64_t fullRebuilds;  // whole-tree rebuilds after removes
+    uint64_t nodesRebuilt;  // total size of the rebuilt subtrees
+    double alpha;           // 0 when the policy is disabled
+    size_t depthLimit;      // current bound, floor(log_{1/alpha}(max size))
+
+    ScapegoatStats() : rebuilds(0), fullRebuilds(0), nodesRebuilt(0), alpha(0), depthLimit(0) {}
+
+    std::string toJSON() const
+    {
+        std::ostringstream os;
+        os << "{\"rebuilds\": " << rebuilds << ", \"full_rebuilds\": " << fullRebuilds
+           << ", \"nodes_rebuilt\": " << nodesRebuilt << ", \"alpha\": " << alpha
+           << ", \"depth_limit\": " << depthLimit << "}";
+        return os.str();
+    }
+};
+
+/**
+ * The policy's state: alpha, the size the depth bound is computed from,
+ * and the bound itself, kept incrementally so an insert needs no log().
+ * Templated like BSTLookupCache so bst.h can use it before it is defined.
+ */
+template<typename Key, typename Value>
+class BSTScapegoat
+{
+public:
+    explicit BSTScapegoat(double alpha) : alpha_(alpha), maxSize_(0), limit_(0), nextPow_(1.0 / alpha)
+    {
+        stats_.alpha = alpha;
+    }
+
+    double alpha() const { return alpha_; }
+    size_t maxSize() const { return maxSize_; }
+    size_t depthLimit() const { return limit_; }
+
+    // the tree grew to size nodes
+    void grew(size_t size)
+    {
+        if (size <= maxSize_) return;
+        maxSize_ = size;
+        while (double(maxSize_) >= nextPow_) {
+            ++limit_;
+            nextPow_ /= alpha_;
+        }
+    }
+    // the whole tree was rebuilt at size nodes
+    void reset(size_t size)
+    {
+        maxSize_ = 0;
+        limit_ = 0;
+        nextPow_ = 1.0 / alpha_;
+        grew(size);
+    }
+
+    ScapegoatStats& counters() { return stats_; }
+    ScapegoatStats stats() const
+    {
+        ScapegoatStats s = stats_;
+        s.depthLimit = limit_;
+        return s;
+    }
+    void resetStats()
+    {
+        stats_ = ScapegoatStats();
+        stats_.alpha = alpha_;
+    }
+
+private:
+    double alpha_;
+    size_t maxSize_;
+    size_t limit_;    // floor(log_{1/alpha}(maxSize_))
+    double nextPow_;  // (1/alpha)^(limit_ + 1): maxSize_ at which limit_ grows
+    ScapegoatStats stats_;
+};
+
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::enableScapegoat(double alpha)
+{
+    if (!(alpha > 0.5 && alpha < 1.0)) throw std::invalid_argument("scapegoat alpha must be in (0.5, 1)");
+    delete scapegoat_;
+    scapegoat_ = new BSTScapegoat<Key, Value>(alpha);
+    scapegoat_->reset(size_);
+}
+
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::disableScapegoat()
+{
+    delete scapegoat_;
+    scapegoat_ = nullptr;
+}
+
+template<typename Key, typename Value>
+ScapegoatStats BinarySearchTree<Key, Value>::scapegoatStats() const
+{
+    return scapegoat_ ? scapegoat_->stats() : ScapegoatStats();
+}
+
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::resetScapegoatStats()
+{
+    if (scapegoat_) scapegoat_->resetStats();
+}
+
+/**
+* Called by findOrInsert after linking n at the given depth (root = 0).
+* Climbs from n, counting the sibling subtrees, until some ancestor's
+* child on the path is too heavy, then rebuilds that ancestor's subtree.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::scapegoatInserted(Node<Key, Value>* n, size_t depth)
+{
+    scapegoat_->grew(size_);
+    if (depth <= scapegoat_->depthLimit()) return;
+
+    const double alpha = scapegoat_->alpha();
+    size_t childSize = 1;
+    Node<Key, Value>* child = n;
+    for (Node<Key, Value>* p = n->getParent(); p != nullptr; child = p, p = p->getParent()) {
+        Node<Key, Value>* sibling = (p->getLeft() == child) ? p->getRight() : p->getLeft();
+        size_t size = childSize + subtreeSize(sibling) + 1;
+        if (double(childSize) > alpha * double(size)) {
+            rebuildSubtree(p, size);
+            ScapegoatStats& c = scapegoat_->counters();
+            ++c.rebuilds;
+            c.nodesRebuilt += size;
+            return;
+        }
+        childSize = size;
+    }
+}
+
+/**
+* Called after a remove: rebuilds everything once the tree has shrunk
+* below alpha of its size at the last full rebuild.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::scapegoatRemoved()
+{
+    if (double(size_) >= scapegoat_->alpha() * double(scapegoat_->maxSize())) return;
+    if (root_ != nullptr) rebuildSubtree(root_, size_);
+    scapegoat_->reset(size_);
+    ScapegoatStats& c = scapegoat_->counters();
+    ++c.fullRebuilds;
+    c.nodesRebuilt += size_;
+}
+
+/**
+* Nodes in n's subtree; iterative, the subtree may be a long path.
+*/
+template<typename Key, typename Value>
+size_t BinarySearchTree<Key, Value>::subtreeSize(Node<Key, Value>* n)
+{
+    if (n == nullptr) return 0;
+    size_t count = 0;
+    std::vector<Node<Key, Value>*> stack(1, n);
+    while (!stack.empty()) {
+        Node<Key, Value>* x = stack.back();
+        stack.pop_back();
+        ++count;
+        if (x->getLeft() != nullptr) stack.push_back(x->getLeft());
+        if (x->getRight() != nullptr) stack.push_back(x->getRight());
+    }
+    return count;
+}
+
+/**
+* Relinks the count nodes of n's subtree into a perfectly balanced one in
+* n's place: an in-order pass collects them, then the middle of each range
+* becomes the root of that range.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::rebuildSubtree(Node<Key, Value>* n, size_t count)
+{
+    Node<Key, Value>* parent = n->getParent();
+    bool left = (parent != nullptr && parent->getLeft() == n);
+
+    std::vector<Node<Key, Value>*> nodes;
+    nodes.reserve(count);
+    Node<Key, Value>* x = n;
+    while (x->getLeft() != nullptr) x = x->getLeft();
+    for (size_t i = 0; i < count; ++i, x = successor(x)) nodes.push_back(x);
+
+    Node<Key, Value>* top = buildBalancedFrom(nodes, 0, nodes.size(), parent);
+    if (parent == nullptr) root_ = top;
+    else if (left) parent->setLeft(top);
+    else parent->setRight(top);
+}
+
+template<typename Key, typename Value>
+Node<Key, Value>* BinarySearchTree<Key, Value>::buildBalancedFrom(
+    const std::vector<Node<Key, Value>*>& nodes, size_t lo, size_t hi, Node<Key, Value>* parent)
+{
+    if (lo >= hi) return nullptr;
+    size_t mid = lo + (hi - lo) / 2;
+    Node<Key, Value>* n = nodes[mid];
+    n->setParent(parent);
+    n->setLeft(buildBalancedFrom(nodes, lo, mid, n));
+    n->setRight(buildBalancedFrom(nodes, mid + 1, hi, n));
+    return n;
+}
+
+#endif
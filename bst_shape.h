@@ -0,0 +1,155 @@
+#ifndef BST_SHAPE_H
+#define BST_SHAPE_H
+
+#include <cmath>
+#include <cstddef>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+// BST shape profiler.
+//
+// BinarySearchTree::shape() walks the tree once, iteratively through the
+// parent pointers (no recursion, no stack), and collects the statistics
+// below. shape_report() emits them as JSON so a monitoring job can decide
+// when an unbalanced tree is worth rebuilding, or confirm that an AVLTree
+// stays under the 1.44 log2(n) height bound.
+
+struct BSTShapeReport
+{
+    size_t nodes;
+    size_t height;                       // levels; a single node has height 1
+    size_t leaves;
+    std::vector<size_t> depthHistogram;  // [d] = nodes at depth d (root is depth 0)
+    std::vector<double> levelFill;       // [d] = depthHistogram[d] / 2^d
+
+    double avgDepth;                // internal path length / n
+    double avgSuccessfulSearch;     // nodes visited by a find that hits, uniform over keys
+    double avgUnsuccessfulSearch;   // nodes visited by a find that misses, uniform over gaps
+    double optimalSuccessfulSearch; // the same for a perfectly balanced tree of n nodes
+    double searchCostRatio;         // avgSuccessfulSearch / optimalSuccessfulSearch
+    size_t minHeight;               // floor(log2 n) + 1
+    double avlHeightBound;          // 1.4405 log2(n + 2) - 0.3277
+
+    BSTShapeReport() :
+        nodes(0), height(0), leaves(0), avgDepth(0), avgSuccessfulSearch(0),
+        avgUnsuccessfulSearch(0), optimalSuccessfulSearch(0), searchCostRatio(1),
+        minHeight(0), avlHeightBound(0)
+    {
+    }
+
+    std::string toJSON() const
+    {
+        std::ostringstream os;
+        os << std::fixed << std::setprecision(4);
+        os << "{\"nodes\": " << nodes
+           << ", \"height\": " << height
+           << ", \"min_height\": " << minHeight
+           << ", \"avl_height_bound\": " << avlHeightBound
+           << ", \"leaves\": " << leaves
+           << ", \"avg_depth\": " << avgDepth
+           << ", \"avg_successful_search\": " << avgSuccessfulSearch
+           << ", \"avg_unsuccessful_search\": " << avgUnsuccessfulSearch
+           << ", \"optimal_successful_search\": " << optimalSuccessfulSearch
+           << ", \"search_cost_ratio\": " << searchCostRatio
+           << ", \"depth_histogram\": [";
+        for (size_t d = 0; d < depthHistogram.size(); ++d) {
+            os << (d ? ", " : "") << depthHistogram[d];
+        }
+        os << "], \"level_fill\": [";
+        for (size_t d = 0; d < levelFill.size(); ++d) {
+            os << (d ? ", " : "") << levelFill[d];
+        }
+        os << "]}";
+        return os.str();
+    }
+};
+
+/**
+* Collects the shape statistics in one in-order walk. Memory use is the
+* histogram only (O(height)).
+*/
+template<typename Key, typename Value>
+BSTShapeReport BinarySearchTree<Key, Value>::shape() const
+{
+    BSTShapeReport r;
+    if (root_ == nullptr) return r;
+
+    double internalPath = 0; // sum of depths
+    double externalPath = 0; // sum of depths of the n+1 null links
+
+    Node<Key, Value>* curr = root_;
+    Node<Key, Value>* prev = nullptr;
+    size_t depth = 0;
+
+    while (curr != nullptr) {
+        Node<Key, Value>* parent = curr->getParent();
+        Node<Key, Value>* left = curr->getLeft();
+        Node<Key, Value>* right = curr->getRight();
+
+        //first time here: record the node, then go left
+        if (prev == parent) {
+            if (r.depthHistogram.size() <= depth) r.depthHistogram.resize(depth + 1, 0);
+            ++r.depthHistogram[depth];
+            ++r.nodes;
+            internalPath += depth;
+            int missing = (left == nullptr) + (right == nullptr);
+            externalPath += double(missing) * (depth + 1);
+            if (missing == 2) ++r.leaves;
+
+            if (left != nullptr) {
+                prev = curr;
+                curr = left;
+                ++depth;
+                continue;
+            }
+        }
+        //back from the left subtree (or there was none): go right
+        if (prev != right && right != nullptr) {
+            prev = curr;
+            curr = right;
+            ++depth;
+            continue;
+        }
+        //both subtrees done: go up
+        prev = curr;
+        curr = parent;
+        --depth;
+    }
+
+    double n = double(r.nodes);
+    r.height = r.depthHistogram.size();
+    r.levelFill.resize(r.height);
+    for (size_t d = 0; d < r.height; ++d) {
+        r.levelFill[d] = double(r.depthHistogram[d]) / std::ldexp(1.0, int(d));
+    }
+    r.avgDepth = internalPath / n;
+    r.avgSuccessfulSearch = r.avgDepth + 1;
+    r.avgUnsuccessfulSearch = externalPath / (n + 1);
+
+    //a perfectly balanced tree fills levels 0..k-1 and puts the rest on level k
+    double optimalPath = 0;
+    size_t remaining = r.nodes;
+    size_t level = 0;
+    while (remaining > 0) {
+        size_t width = size_t(1) << level;
+        size_t here = remaining < width ? remaining : width;
+        optimalPath += double(here) * level;
+        remaining -= here;
+        ++level;
+    }
+    r.minHeight = level;
+    r.optimalSuccessfulSearch = optimalPath / n + 1;
+    r.searchCostRatio = r.avgSuccessfulSearch / r.optimalSuccessfulSearch;
+    r.avlHeightBound = 1.4405 * std::log2(n + 2) - 0.3277;
+    return r;
+}
+
+template<typename Key, typename Value>
+std::string BinarySearchTree<Key, Value>::shape_report() const
+{
+    return shape().toJSON();
+}
+
+#endif
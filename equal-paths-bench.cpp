@@ -0,0 +1,138 @@
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+#include <string>
+#include "equal-paths.h"
+#include "equal-paths-parallel.h"
+#include "equal-paths-stream.h"
+using namespace std;
+
+// Benchmark for equalPaths on generated trees of 10M+ nodes.
+// usage: equal-paths-bench [levels] [max threads]
+//        (default 24 levels = 16.7M nodes, threads up to hardware_concurrency)
+
+// all generated nodes live in one vector: one allocation for the whole tree
+vector<Node> pool;
+
+// perfect tree with the given number of levels, in heap order
+Node* buildPerfect(int levels, size_t spare)
+{
+  size_t n = (size_t(1) << levels) - 1;
+  pool.clear();
+  pool.reserve(n + spare);
+  for (size_t i = 0; i < n; ++i) {
+    pool.push_back(Node(int(i)));
+  }
+  for (size_t i = 0; 2 * i + 2 < n; ++i) {
+    pool[i].left = &pool[2 * i + 1];
+    pool[i].right = &pool[2 * i + 2];
+  }
+  return &pool[0];
+}
+
+// a single path of n nodes, each the left child of the previous one
+Node* buildChain(size_t n)
+{
+  pool.clear();
+  pool.reserve(n);
+  for (size_t i = 0; i < n; ++i) {
+    pool.push_back(Node(int(i)));
+  }
+  for (size_t i = 0; i + 1 < n; ++i) {
+    pool[i].left = &pool[i + 1];
+  }
+  return &pool[0];
+}
+
+// hangs one extra node under the leftmost or rightmost leaf
+void addDeepLeaf(Node* root, bool leftmost)
+{
+  Node* n = root;
+  while (leftmost ? n->left != NULL : n->right != NULL) {
+    n = leftmost ? n->left : n->right;
+  }
+  pool.push_back(Node(-1));
+  n->left = &pool.back();
+}
+
+// preorder encoding of the tree ("1" per node, "#" per empty child),
+// written iteratively so the chain does not recurse
+string serializePreorder(Node* root)
+{
+  string out;
+  vector<Node*> stack(1, root);
+  while (!stack.empty()) {
+    Node* n = stack.back();
+    stack.pop_back();
+    if (n == NULL) {
+      out += "# ";
+      continue;
+    }
+    out += "1 ";
+    stack.push_back(n->right);
+    stack.push_back(n->left);
+  }
+  return out;
+}
+
+// checks the serialized tree without building nodes
+void runStream(const char* msg, const string& data)
+{
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  bool result = equalPathsBuffer(data.data(), data.size());
+  double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+  cout << msg << ": " << result << "  (" << data.size() << " bytes, " << ms << " ms)" << endl;
+}
+
+// threads == 0 runs the sequential equalPaths
+double run(const char* msg, Node* root, unsigned threads = 0)
+{
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  bool result = threads == 0 ? equalPaths(root) : equalPathsParallel(root, threads);
+  double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+  cout << msg;
+  if (threads > 0) cout << " [" << threads << " threads]";
+  cout << ": " << result << "  (" << pool.size() << " nodes, " << ms << " ms)" << endl;
+  return ms;
+}
+
+int main(int argc, char* argv[])
+{
+  int levels = (argc > 1) ? atoi(argv[1]) : 24;
+  unsigned maxThreads = (argc > 2) ? unsigned(atoi(argv[2])) : thread::hardware_concurrency();
+  if (maxThreads == 0) maxThreads = 1;
+
+  run("Perfect tree (full scan)", buildPerfect(levels, 0));
+
+  Node* root = buildPerfect(levels, 1);
+  addDeepLeaf(root, true);
+  run("Perfect tree, leftmost leaf one deeper (early exit)", root);
+
+  root = buildPerfect(levels, 1);
+  addDeepLeaf(root, false);
+  run("Perfect tree, rightmost leaf one deeper (found last)", root);
+
+  run("Chain of 10M nodes (deep)", buildChain(size_t(10) * 1000 * 1000));
+
+  // scaling of the parallel version against the sequential one
+  root = buildPerfect(levels, 1);
+  double sequential = run("Perfect tree, sequential", root);
+  for (unsigned t = 1; t <= maxThreads; t *= 2) {
+    double ms = run("Perfect tree, parallel", root, t);
+    cout << "  speedup vs sequential: " << (ms > 0 ? sequential / ms : 0) << "x" << endl;
+  }
+  addDeepLeaf(root, false);
+  run("Perfect tree, rightmost leaf one deeper, parallel", root, maxThreads);
+
+  // streaming check straight from the preorder encoding
+  root = buildPerfect(levels, 1);
+  string data = serializePreorder(root);
+  runStream("Perfect tree, preorder stream", data);
+  addDeepLeaf(root, false);
+  data = serializePreorder(root);
+  runStream("Perfect tree, rightmost leaf one deeper, preorder stream", data);
+
+  return 0;
+}
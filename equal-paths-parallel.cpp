@@ -0,0 +1,132 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <deque>
+#include <utility>
+
+#include "equal-paths-parallel.h"
+
+using namespace std;
+
+namespace {
+
+// state shared by all tasks of one equalPathsParallel call
+struct SharedCheck
+{
+  atomic<int> leafDepth;   // depth of the first leaf seen, -1 until then
+  atomic<bool> mismatch;   // set once any two leaf depths disagree
+
+  SharedCheck() : leafDepth(-1), mismatch(false) {}
+
+  // publishes or checks one leaf depth; target caches the known depth
+  bool leafOk(int depth, int& target)
+  {
+    if (target == -1) {
+      int expected = -1;
+      if (leafDepth.compare_exchange_strong(expected, depth)) {
+        target = depth;
+        return true;
+      }
+      target = expected;
+    }
+    return depth == target;
+  }
+};
+
+// how many nodes a task walks between checks of the cancel flag
+const unsigned CANCEL_CHECK_INTERVAL = 4096;
+
+// iterative DFS over one subtree; returns false on a mismatch
+bool checkSubtree(Node* root, int rootDepth, SharedCheck& shared)
+{
+  vector<pair<Node*, int> > stack;
+  stack.push_back(make_pair(root, rootDepth));
+  int target = shared.leafDepth.load(memory_order_relaxed);
+  unsigned sinceCheck = 0;
+
+  while (!stack.empty()) {
+    if (++sinceCheck == CANCEL_CHECK_INTERVAL) {
+      sinceCheck = 0;
+      if (shared.mismatch.load(memory_order_relaxed)) return false;
+      if (target == -1) target = shared.leafDepth.load(memory_order_relaxed);
+    }
+
+    Node* n = stack.back().first;
+    int depth = stack.back().second;
+    stack.pop_back();
+
+    if (n->left == nullptr && n->right == nullptr) {
+      if (!shared.leafOk(depth, target)) return false;
+      continue;
+    }
+    if (target != -1 && depth >= target) return false;
+
+    if (n->right != nullptr) stack.push_back(make_pair(n->right, depth + 1));
+    if (n->left != nullptr) stack.push_back(make_pair(n->left, depth + 1));
+  }
+  return true;
+}
+
+}
+
+bool equalPathsParallel(Node * root, unsigned threads)
+{
+  if (root == nullptr) return true;
+  if (threads == 0) threads = thread::hardware_concurrency();
+  if (threads == 0) threads = 1;
+
+  SharedCheck shared;
+  int target = -1;
+
+  //split the top of the tree breadth-first until there are enough subtrees
+  //to keep every thread busy; leaves met on the way are checked right here
+  const size_t wanted = size_t(threads) * 8;
+  deque<pair<Node*, int> > tasks;
+  tasks.push_back(make_pair(root, 0));
+  while (!tasks.empty() && tasks.size() < wanted) {
+    size_t levelSize = tasks.size();
+    bool expanded = false;
+    for (size_t i = 0; i < levelSize; ++i) {
+      Node* n = tasks.front().first;
+      int depth = tasks.front().second;
+      tasks.pop_front();
+      if (n->left == nullptr && n->right == nullptr) {
+        if (!shared.leafOk(depth, target)) return false;
+        continue;
+      }
+      if (target != -1 && depth >= target) return false;
+      if (n->left != nullptr) tasks.push_back(make_pair(n->left, depth + 1));
+      if (n->right != nullptr) tasks.push_back(make_pair(n->right, depth + 1));
+      expanded = true;
+    }
+    //a long chain never widens; stop splitting and just walk it
+    if (!expanded || tasks.size() < 2) break;
+  }
+
+  if (tasks.empty()) return true;
+  if (threads == 1 || tasks.size() == 1) {
+    for (size_t i = 0; i < tasks.size(); ++i) {
+      if (!checkSubtree(tasks[i].first, tasks[i].second, shared)) return false;
+    }
+    return true;
+  }
+
+  //workers pull task indices until the queue is drained or a mismatch is found
+  vector<pair<Node*, int> > work(tasks.begin(), tasks.end());
+  atomic<size_t> next(0);
+  vector<thread> workers;
+  for (unsigned t = 0; t < threads; ++t) {
+    workers.push_back(thread([&]() {
+      size_t i;
+      while (!shared.mismatch.load(memory_order_relaxed) &&
+             (i = next.fetch_add(1, memory_order_relaxed)) < work.size()) {
+        if (!checkSubtree(work[i].first, work[i].second, shared)) {
+          shared.mismatch.store(true, memory_order_relaxed);
+        }
+      }
+    }));
+  }
+  for (size_t t = 0; t < workers.size(); ++t) workers[t].join();
+
+  return !shared.mismatch.load();
+}
@@ -0,0 +1,20 @@
+#ifndef EQUAL_PATHS_PARALLEL_H
+#define EQUAL_PATHS_PARALLEL_H
+
+#include "equal-paths.h"
+
+/**
+ * @brief Parallel version of equalPaths for very large trees.
+ *
+ *        The top levels of the tree are split into independent subtree
+ *        tasks that worker threads pull from a shared queue. Each task walks
+ *        its subtree iteratively and checks leaf depths against the first
+ *        leaf depth found by any thread; the first mismatch cancels the
+ *        remaining tasks.
+ *
+ * @param root Pointer to the root of the tree to check for equal paths
+ * @param threads Number of worker threads, 0 for std::thread::hardware_concurrency()
+ */
+bool equalPathsParallel(Node * root, unsigned threads = 0);
+
+#endif
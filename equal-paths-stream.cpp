@@ -0,0 +1,176 @@
+#include <deque>
+#include <stdexcept>
+#include <vector>
+
+#include "equal-paths-stream.h"
+
+using namespace std;
+
+namespace {
+
+enum Token { TOKEN_NODE, TOKEN_NULL, TOKEN_END };
+
+// returns true if the token text so far is a null marker ("#" or "null")
+bool isNullText(const char* text, size_t len)
+{
+  return (len == 1 && text[0] == '#') ||
+         (len == 4 && text[0] == 'n' && text[1] == 'u' && text[2] == 'l' && text[3] == 'l');
+}
+
+bool isSpace(int c)
+{
+  return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\f' || c == '\v';
+}
+
+// tokenizer over an istream; never stores more than 5 characters of a token
+class StreamTokens
+{
+public:
+  explicit StreamTokens(istream& in) : in_(in) {}
+
+  Token next()
+  {
+    streambuf* sb = in_.rdbuf();
+    int c = sb->sgetc();
+    while (c != char_traits<char>::eof() && isSpace(c)) c = sb->snextc();
+    if (c == char_traits<char>::eof()) return TOKEN_END;
+
+    char text[5];
+    size_t len = 0;
+    while (c != char_traits<char>::eof() && !isSpace(c)) {
+      if (len < sizeof(text)) text[len] = char(c);
+      ++len;
+      c = sb->snextc();
+    }
+    return isNullText(text, len) ? TOKEN_NULL : TOKEN_NODE;
+  }
+
+private:
+  istream& in_;
+};
+
+// tokenizer over a memory buffer
+class BufferTokens
+{
+public:
+  BufferTokens(const char* data, size_t length) : p_(data), end_(data + length) {}
+
+  Token next()
+  {
+    while (p_ != end_ && isSpace(*p_)) ++p_;
+    if (p_ == end_) return TOKEN_END;
+    const char* start = p_;
+    while (p_ != end_ && !isSpace(*p_)) ++p_;
+    return isNullText(start, size_t(p_ - start)) ? TOKEN_NULL : TOKEN_NODE;
+  }
+
+private:
+  const char* p_;
+  const char* end_;
+};
+
+// one pending node of a preorder stream
+struct Frame
+{
+  int depth;
+  int childrenSeen;
+  bool hasChild;
+};
+
+// leaf depth bookkeeping shared by both layouts
+struct LeafCheck
+{
+  int leafDepth;
+  LeafCheck() : leafDepth(-1) {}
+
+  bool leaf(int depth)
+  {
+    if (leafDepth == -1) leafDepth = depth;
+    return depth == leafDepth;
+  }
+  //a node deeper than or at a known leaf depth can only lead to deeper leaves
+  bool internalOk(int depth) const { return leafDepth == -1 || depth < leafDepth; }
+};
+
+template<class Tokens>
+bool checkPreorder(Tokens& tokens)
+{
+  Token t = tokens.next();
+  if (t != TOKEN_NODE) return true; //empty tree
+
+  LeafCheck check;
+  vector<Frame> stack;
+  Frame root = { 0, 0, false };
+  stack.push_back(root);
+
+  while (!stack.empty()) {
+    t = tokens.next();
+    if (t == TOKEN_END) throw invalid_argument("preorder stream ends mid-tree");
+
+    Frame& top = stack.back();
+    ++top.childrenSeen;
+    if (t == TOKEN_NODE) {
+      top.hasChild = true;
+      if (!check.internalOk(top.depth)) return false;
+      Frame child = { top.depth + 1, 0, false };
+      stack.push_back(child);
+      continue;
+    }
+
+    //a null child: close every node whose two children are now known
+    //(a child is counted in its parent when its first token is read)
+    while (!stack.empty() && stack.back().childrenSeen == 2) {
+      Frame done = stack.back();
+      stack.pop_back();
+      if (!done.hasChild && !check.leaf(done.depth)) return false;
+    }
+  }
+  return true;
+}
+
+template<class Tokens>
+bool checkLevelOrder(Tokens& tokens)
+{
+  Token t = tokens.next();
+  if (t != TOKEN_NODE) return true; //empty tree
+
+  LeafCheck check;
+  deque<int> pending; //depths of nodes whose children have not been read yet
+  pending.push_back(0);
+
+  while (!pending.empty()) {
+    int depth = pending.front();
+    pending.pop_front();
+    bool hasChild = false;
+    for (int c = 0; c < 2; ++c) {
+      //a missing token is an omitted trailing null
+      if (tokens.next() == TOKEN_NODE) {
+        hasChild = true;
+        if (!check.internalOk(depth)) return false;
+        pending.push_back(depth + 1);
+      }
+    }
+    if (!hasChild && !check.leaf(depth)) return false;
+  }
+  return true;
+}
+
+template<class Tokens>
+bool check(Tokens& tokens, TreeEncoding encoding)
+{
+  return encoding == LEVEL_ORDER ? checkLevelOrder(tokens) : checkPreorder(tokens);
+}
+
+}
+
+bool equalPathsStream(istream& in, TreeEncoding encoding)
+{
+  StreamTokens tokens(in);
+  return check(tokens, encoding);
+}
+
+bool equalPathsBuffer(const char* data, size_t length, TreeEncoding encoding)
+{
+  BufferTokens tokens(data, length);
+  return check(tokens, encoding);
+}
@@ -0,0 +1,37 @@
+#ifndef EQUAL_PATHS_STREAM_H
+#define EQUAL_PATHS_STREAM_H
+
+#include <cstddef>
+#include <istream>
+
+/**
+ * Serialized tree layouts understood by the streaming checkers.
+ *
+ * Tokens are separated by whitespace. "#" or "null" marks an empty child;
+ * any other token is a node (its text is ignored).
+ *
+ *  PREORDER:    node, then its left subtree, then its right subtree, with a
+ *               null marker for every empty child, e.g. "1 2 # # 3 # #".
+ *  LEVEL_ORDER: breadth-first, two child tokens per node in queue order;
+ *               trailing null markers may be omitted, e.g. "1 2 3".
+ */
+enum TreeEncoding { PREORDER, LEVEL_ORDER };
+
+/**
+ * @brief Same answer as equalPaths, computed straight from a serialized tree
+ *        without building any Node objects.
+ *
+ *        O(n) time. Memory is O(height) for PREORDER, and O(width) for
+ *        LEVEL_ORDER (a whole level is pending before its children arrive).
+ *        Stops reading at the first mismatching leaf.
+ *
+ * @throws std::invalid_argument if a PREORDER stream ends mid-tree
+ */
+bool equalPathsStream(std::istream& in, TreeEncoding encoding = PREORDER);
+
+/**
+ * @brief Same as equalPathsStream, reading from a memory buffer.
+ */
+bool equalPathsBuffer(const char* data, size_t length, TreeEncoding encoding = PREORDER);
+
+#endif
@@ -1,6 +1,8 @@
 #ifndef RECCHECK
 //if you want to add any #includes like <iostream> you must do them here (before the next endif)
 #include <iostream>
+#include <vector>
+#include <utility>
 
 #endif
 
@@ -12,38 +14,40 @@ using namespace std;
 
 
 // You may add any prototypes of helper functions here
-//-1 means unbalanced 
-//0 means height = 0
-//pos integers is the height 
-int height (Node* root) {
-  //if we are at bottom return 0
-  if (root == nullptr) return 0; 
-
-  int left = height (root->left);
-  int right = height (root->right);
-
-  //if either branch is unbalanced ripple up
-  if (left==-1 || right==-1) return -1;
-
-  //if both children exist & unequal height ripple up  
-  if ((root->left!=nullptr) && (root->right !=nullptr) && left!=right) return -1;
-
-  //at this point the tree is balanced on both branches 
-  else {
-     return 1 + max((height (root->left)) , (height(root->right)));
-  }
-}
 
 
 bool equalPaths(Node * root)
 {
-    // Add your code below
-    //check if tree height is same for all leaves 
-    //so is the tree full 
-
-  //use height function to see if tree is same height on all paths 
-  int path = height(root); 
-  if (path==-1) return false;
-  else return true; 
+  //empty tree has no leaves, so every path trivially matches
+  if (root == nullptr) return true;
+
+  //depth-first walk with an explicit stack of (node, depth) instead of
+  //recursion, so a very deep tree cannot overflow the call stack.
+  //the stack holds at most one pending right child per level: O(height)
+  vector<pair<Node*, int> > stack;
+  stack.push_back(make_pair(root, 0));
+
+  //depth of the first leaf found, -1 until then
+  int leafDepth = -1;
+
+  while (!stack.empty()) {
+    Node* n = stack.back().first;
+    int depth = stack.back().second;
+    stack.pop_back();
+
+    //leaf: must match the first leaf's depth
+    if (n->left == nullptr && n->right == nullptr) {
+      if (leafDepth == -1) leafDepth = depth;
+      else if (depth != leafDepth) return false;
+      continue;
+    }
+
+    //internal node already at the leaf depth: every leaf below is deeper
+    if (leafDepth != -1 && depth >= leafDepth) return false;
+
+    if (n->right != nullptr) stack.push_back(make_pair(n->right, depth + 1));
+    if (n->left != nullptr) stack.push_back(make_pair(n->left, depth + 1));
+  }
 
-}
\ No newline at end of file
+  return true;
+}
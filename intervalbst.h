@@ -0,0 +1,219 @@
+#ifndef INTERVALBST_H
+#define INTERVALBST_H
+
+#include <cstddef>
+#include <functional>
+#include <ostream>
+#include <stdexcept>
+#include "avlbst.h"
+
+/*
+  An AVLTree of closed intervals [lo, hi] for overlap queries.
+
+  Intervals are keys, ordered by lo, then hi; an interval inserted twice is
+  one key, as in the other trees. Each node also stores the largest hi in
+  its subtree (getMaxEnd()), kept through AVLTree's augmentation hooks: the
+  tree recomputes it on both nodes of every rotation, and along the path to
+  the root whenever a node is linked, unlinked or swapped (nodeSwap) by
+  insert, remove and merge.
+
+  overlapping(a, b, out) walks the tree in order and skips
+  - every subtree whose max end is below a (nothing in it reaches a), and
+  - the right subtree, and the node itself, once a node starts after b
+    (everything right of it starts later still).
+  Every node visited either overlaps the query or lies on the path to one
+  that does, so a query reporting k intervals visits O(log n + k) nodes when
+  the matches are neighbours in key order (short intervals), and at worst
+  O(min(n, (k + 1) log n)) when they are scattered through the tree (long
+  intervals starting far apart). A linear scan costs O(n) whatever k is.
+*/
+
+/**
+* A closed interval [lo, hi]; ordered by lo, then hi.
+*/
+template <class T>
+struct Interval
+{
+    T lo;
+    T hi;
+
+    bool contains(const T& t) const { return !(t < lo) && !(hi < t); }
+    bool overlaps(const T& a, const T& b) const { return !(b < lo) && !(hi < a); }
+};
+
+template <class T>
+bool operator<(const Interval<T>& x, const Interval<T>& y)
+{
+    return x.lo < y.lo || (!(y.lo < x.lo) && x.hi < y.hi);
+}
+
+template <class T>
+bool operator>(const Interval<T>& x, const Interval<T>& y)
+{
+    return y < x;
+}
+
+template <class T>
+bool operator==(const Interval<T>& x, const Interval<T>& y)
+{
+    return !(x < y) && !(y < x);
+}
+
+// "[lo, hi]", for print() and the exporters
+template <class T>
+std::ostream& operator<<(std::ostream& os, const Interval<T>& i)
+{
+    return os << '[' << i.lo << ", " << i.hi << ']';
+}
+
+template <class T>
+Interval<T> makeInterval(const T& lo, const T& hi)
+{
+    Interval<T> i;
+    i.lo = lo;
+    i.hi = hi;
+    return i;
+}
+
+// lets an IntervalTree enable the lookup cache or membership filter,
+// which hash keys
+namespace std {
+template <class T>
+struct hash<Interval<T> >
+{
+    size_t operator()(const Interval<T>& i) const
+    {
+        size_t h = hash<T>()(i.lo);
+        return h ^ (hash<T>()(i.hi) + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2));
+    }
+};
+}
+
+/**
+* AVLNode with the largest end point in its subtree.
+*/
+template <class T, class Value>
+class IntervalNode : public AVLNode<Interval<T>, Value>
+{
+public:
+    IntervalNode(const Interval<T>& key, const Value& value, AVLNode<Interval<T>, Value>* parent) :
+        AVLNode<Interval<T>, Value>(key, value, parent), maxEnd_(key.hi)
+    {
+    }
+
+    const T& getMaxEnd() const { return maxEnd_; }
+    void setMaxEnd(const T& maxEnd) { maxEnd_ = maxEnd; }
+
+    IntervalNode<T, Value>* getLeft() const { return static_cast<IntervalNode<T, Value>*>(this->left_); }
+    IntervalNode<T, Value>* getRight() const { return static_cast<IntervalNode<T, Value>*>(this->right_); }
+
+protected:
+    T maxEnd_;
+};
+
+template <class T, class Value, class Stats = NoAVLStats, class Balance = AVLBalance>
+class IntervalTree : public AVLTree<Interval<T>, Value, Stats, Balance>
+{
+public:
+    typedef AVLTree<Interval<T>, Value, Stats, Balance> Base;
+    typedef typename BinarySearchTree<Interval<T>, Value>::iterator iterator;
+
+    IntervalTree() { this->augmented_ = true; }
+    // O(n) structural copy; the clones carry their max ends
+    IntervalTree(const IntervalTree& other) : Base()
+    {
+        this->augmented_ = true;
+        this->stats_ = other.stats_;
+        this->copyFrom(other);
+    }
+    IntervalTree(IntervalTree&& other) = default;
+    IntervalTree& operator=(const IntervalTree& other) = default;
+    IntervalTree& operator=(IntervalTree&& other) = default;
+    // AVLTree::merge, limited to another IntervalTree: any other source's
+    // nodes have no max end
+    void merge(IntervalTree&& other) { Base::merge(std::move(other)); }
+    // AVLTree::swap, likewise
+    void swap(IntervalTree& other) { Base::swap(other); }
+
+    using Base::insert;
+    using Base::remove;
+    // inserts [lo, hi], or sets its value if present; throws
+    // std::invalid_argument if hi < lo
+    void insert(const T& lo, const T& hi, const Value& value)
+    {
+        this->insert(std::make_pair(makeInterval(lo, hi), value));
+    }
+    void remove(const T& lo, const T& hi) { this->remove(makeInterval(lo, hi)); }
+
+    // writes an iterator to every interval containing t, in key order, to
+    // *out++; returns out
+    template<class OutIt>
+    OutIt overlapping(const T& t, OutIt out) const { return overlapping(t, t, out); }
+    // the same for every interval overlapping [a, b]
+    template<class OutIt>
+    OutIt overlapping(const T& a, const T& b, OutIt out) const;
+
+    // largest end point in the tree; the tree must not be empty
+    const T& maxEnd() const { return root()->getMaxEnd(); }
+
+protected:
+    virtual AVLNode<Interval<T>, Value>* makeNode(const Interval<T>& key, const Value& value,
+                                                  AVLNode<Interval<T>, Value>* parent) override
+    {
+        if (key.hi < key.lo) throw std::invalid_argument("Interval end before start");
+        return new IntervalNode<T, Value>(key, value, parent);
+    }
+    virtual Node<Interval<T>, Value>* cloneNode(const Node<Interval<T>, Value>* n,
+                                                Node<Interval<T>, Value>* parent) const override
+    {
+        const IntervalNode<T, Value>* src = static_cast<const IntervalNode<T, Value>*>(n);
+        IntervalNode<T, Value>* c = new IntervalNode<T, Value>(n->getKey(), n->getValue(),
+                                                               static_cast<AVLNode<Interval<T>, Value>*>(parent));
+        c->setBalance(src->getBalance());
+        c->setMaxEnd(src->getMaxEnd());
+        return c;
+    }
+    virtual void updateNode(AVLNode<Interval<T>, Value>* n) override;
+
+    template<class OutIt>
+    void collect(const IntervalNode<T, Value>* n, const T& a, const T& b, OutIt& out) const;
+
+    IntervalNode<T, Value>* root() const { return static_cast<IntervalNode<T, Value>*>(this->root_); }
+};
+
+template<class T, class Value, class Stats, class Balance>
+void IntervalTree<T, Value, Stats, Balance>::updateNode(AVLNode<Interval<T>, Value>* n)
+{
+    IntervalNode<T, Value>* x = static_cast<IntervalNode<T, Value>*>(n);
+    const T* m = &x->getKey().hi;
+    if (x->getLeft() != nullptr && *m < x->getLeft()->getMaxEnd()) m = &x->getLeft()->getMaxEnd();
+    if (x->getRight() != nullptr && *m < x->getRight()->getMaxEnd()) m = &x->getRight()->getMaxEnd();
+    x->setMaxEnd(*m);
+}
+
+template<class T, class Value, class Stats, class Balance>
+template<class OutIt>
+OutIt IntervalTree<T, Value, Stats, Balance>::overlapping(const T& a, const T& b, OutIt out) const
+{
+    if (!(b < a)) collect(root(), a, b, out);
+    return out;
+}
+
+/**
+* In-order walk of n's subtree with the two cut-offs described at the top.
+* Recursion depth is the tree's height.
+*/
+template<class T, class Value, class Stats, class Balance>
+template<class OutIt>
+void IntervalTree<T, Value, Stats, Balance>::collect(const IntervalNode<T, Value>* n, const T& a, const T& b,
+                                                     OutIt& out) const
+{
+    while (n != nullptr && !(n->getMaxEnd() < a)) {
+        collect(n->getLeft(), a, b, out);
+        if (b < n->getKey().lo) return;
+        if (!(n->getKey().hi < a)) *out++ = this->iteratorAt(const_cast<IntervalNode<T, Value>*>(n));
+        n = n->getRight(); // tail call by hand
+    }
+}
+
+#endif
@@ -0,0 +1,637 @@
+#ifndef MAPPEDAVLBST_H
+#define MAPPEDAVLBST_H
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+  An AVL map stored in a memory-mapped file, for several processes to share.
+
+  AVLTree's nodes cannot be shared as they are: they link through raw
+  pointers, which mean nothing in another address space, and they carry a
+  vtable pointer. So this is a separate tree with the same balancing (a
+  right - left height balance in each node, single and double rotations)
+  over plain nodes in the file: { key, value, left, right, balance }, the
+  links being byte offsets from the start of the mapping, 0 for null. Key
+  and Value must be trivially copyable; the bytes in the file are the
+  objects. A path under /dev/shm gives a POSIX shared-memory segment
+  (what shm_open() creates); any other path a file that outlives the
+  processes.
+
+  One process opens the file as the writer (MAP_CREATE or MAP_WRITER; an
+  exclusive flock keeps it the only one) and inserts and removes. Any
+  number of processes open it as readers (MAP_READER) and look keys up
+  straight in the mapping, with no deserialization.
+
+  Readers do not lock. The header holds a sequence counter (seqlock): the
+  writer makes it odd for the duration of each change and even again
+  afterwards. A lookup reads the counter, descends, and retries if the
+  counter was odd or has moved since. Nodes may be half-written during a
+  change, so the descent bounds-checks every offset and gives up after
+  MAX_DEPTH steps rather than trust them; only a lookup that validates is
+  returned. A lookup that cannot get a consistent read backs off (sleeping
+  after the first few tries) and throws std::runtime_error after
+  MAX_READ_RETRIES, a second or two: a writer that dies mid-change leaves
+  the counter odd for good. Reopening with MAP_WRITER is refused then too.
+
+  The file grows by doubling; the writer grows it before a change starts,
+  and readers remap when the header says the file is larger than their
+  mapping. Removed nodes go on a free list and are reused.
+
+  Threads may share a reader: lookups that remap do so under a mutex, and
+  the older mappings stay until the tree is destroyed, so a lookup still
+  descending through one is unaffected. They map the same file, so they
+  see the same bytes; with the file doubling each time, they add up to
+  less address space than the current mapping. A writer's inserts and
+  removes must come from one thread at a time, as with the other trees.
+*/
+
+enum MappedMode { MAP_CREATE, MAP_WRITER, MAP_READER };
+
+/**
+* A node as stored in the file.
+*/
+template <class Key, class Value>
+struct MappedAVLNode
+{
+    Key key;
+    Value value;
+    uint64_t left;   // offsets from the start of the mapping, 0 = none
+    uint64_t right;
+    int8_t balance;  // height(right) - height(left)
+};
+
+template <class Key, class Value>
+class MappedAVLTree
+{
+public:
+    static_assert(std::is_trivially_copyable<Key>::value, "MappedAVLTree keys are stored as raw bytes");
+    static_assert(std::is_trivially_copyable<Value>::value, "MappedAVLTree values are stored as raw bytes");
+    static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "the seqlock counter must be lock-free to be shared");
+
+    // MAP_CREATE truncates (or creates) path with room for capacity nodes;
+    // MAP_WRITER and MAP_READER open an existing tree. Throws
+    // std::system_error if the file cannot be opened, locked or mapped,
+    // std::runtime_error if it does not hold a tree of these types.
+    MappedAVLTree(const std::string& path, MappedMode mode, size_t capacity = 1024);
+    ~MappedAVLTree();
+    MappedAVLTree(const MappedAVLTree&) = delete;
+    MappedAVLTree& operator=(const MappedAVLTree&) = delete;
+
+    // writer only (std::logic_error otherwise). insert() overwrites the
+    // value of an existing key, like the other trees
+    void insert(const std::pair<const Key, Value>& keyValuePair);
+    void remove(const Key& key);
+    void clear();
+    // flushes the mapping to the file (msync); not needed for /dev/shm
+    void sync();
+
+    // any process or thread: true and value copied out if key is present.
+    // find() and size() throw std::runtime_error if the writer never
+    // finishes its change (see MAX_READ_RETRIES)
+    bool find(const Key& key, Value& value) const;
+    bool contains(const Key& key) const;
+    size_t size() const;
+    bool empty() const { return size() == 0; }
+    bool isWriter() const { return mode_ != MAP_READER; }
+
+    // deeper than any AVL tree of 2^64 nodes (1.44 log2 n)
+    static const int MAX_DEPTH = 96;
+    // tries at a consistent read before find() and size() throw; all but
+    // the first few sleep READ_BACKOFF_US
+    static const int MAX_READ_RETRIES = 10000;
+    static const int READ_BACKOFF_US = 100;
+
+protected:
+    typedef MappedAVLNode<Key, Value> MNode;
+
+    struct Header
+    {
+        uint64_t magic;
+        uint32_t version;
+        uint32_t keySize;
+        uint32_t valueSize;
+        uint32_t nodeSize;
+        std::atomic<uint64_t> seq;  // odd while the writer changes the tree
+        uint64_t root;
+        uint64_t size;
+        uint64_t bytes;             // file size
+        uint64_t next;              // first never-used node slot
+        uint64_t freeList;          // removed nodes, chained through left
+    };
+
+    static const uint64_t MAGIC = 0x4c56414d54534231ULL; // "1BSTMAVL"
+    static const uint32_t VERSION = 1;
+
+    // first node slot, after the header, aligned for MNode
+    static uint64_t firstNode()
+    {
+        const uint64_t a = alignof(MNode) > 8 ? alignof(MNode) : 8;
+        return (sizeof(Header) + a - 1) / a * a;
+    }
+
+    // one mapping of the file's first bytes; never changes once published
+    struct View
+    {
+        char* base;
+        size_t bytes;
+    };
+
+    const View* view() const { return view_.load(std::memory_order_acquire); }
+    Header* header() const { return reinterpret_cast<Header*>(view()->base); }
+    MNode& node(uint64_t off) const { return *reinterpret_cast<MNode*>(view()->base + off); }
+
+    void mapBytes(size_t bytes);
+    void remapIfGrown() const;
+    void unmapAll();
+    void readBackoff(int attempt) const;
+    void requireWriter() const;
+    void reserveNode();
+    uint64_t allocNode(const Key& key, const Value& value);
+    void freeNode(uint64_t off);
+    void beginWrite();
+    void endWrite();
+
+    uint64_t insertAt(uint64_t off, const Key& key, const Value& value, bool& grew);
+    uint64_t removeAt(uint64_t off, const Key& key, bool& shrank, bool& found);
+    uint64_t removeMin(uint64_t off, uint64_t& min, bool& shrank);
+    uint64_t rotateLeft(uint64_t off);
+    uint64_t rotateRight(uint64_t off);
+    uint64_t rebalance(uint64_t off);
+
+    MappedMode mode_;
+    int fd_;
+    // the latest mapping; const lookups replace it when the writer grew
+    // the file, so it and views_ are mutable
+    mutable std::atomic<const View*> view_;
+    mutable std::mutex remapMutex_;
+    mutable std::vector<View*> views_;  // every mapping made, oldest first
+};
+
+template<class Key, class Value>
+MappedAVLTree<Key, Value>::MappedAVLTree(const std::string& path, MappedMode mode, size_t capacity) :
+    mode_(mode), fd_(-1), view_(nullptr)
+{
+    int flags = (mode == MAP_READER) ? O_RDONLY : (mode == MAP_CREATE ? O_RDWR | O_CREAT : O_RDWR);
+    fd_ = ::open(path.c_str(), flags, 0644);
+    if (fd_ < 0) throw std::system_error(errno, std::generic_category(), "open " + path);
+    try {
+        if (mode != MAP_READER && ::flock(fd_, LOCK_EX | LOCK_NB) != 0) {
+            throw std::system_error(errno, std::generic_category(), "another writer holds " + path);
+        }
+        if (mode == MAP_CREATE) {
+            uint64_t bytes = firstNode() + uint64_t(capacity ? capacity : 1) * sizeof(MNode);
+            if (::ftruncate(fd_, 0) != 0 || ::ftruncate(fd_, off_t(bytes)) != 0) {
+                throw std::system_error(errno, std::generic_category(), "ftruncate " + path);
+            }
+            mapBytes(bytes);
+            Header* h = header();
+            h->magic = MAGIC;
+            h->version = VERSION;
+            h->keySize = sizeof(Key);
+            h->valueSize = sizeof(Value);
+            h->nodeSize = sizeof(MNode);
+            new (&h->seq) std::atomic<uint64_t>(0);
+            h->root = 0;
+            h->size = 0;
+            h->bytes = bytes;
+            h->next = firstNode();
+            h->freeList = 0;
+            return;
+        }
+
+        struct stat st;
+        if (::fstat(fd_, &st) != 0 || size_t(st.st_size) < firstNode() + sizeof(MNode)) {
+            throw std::runtime_error(path + " is not a mapped tree");
+        }
+        mapBytes(size_t(st.st_size));
+        const Header* h = header();
+        if (h->magic != MAGIC || h->version != VERSION || h->keySize != sizeof(Key) ||
+            h->valueSize != sizeof(Value) || h->nodeSize != sizeof(MNode)) {
+            throw std::runtime_error(path + " holds a different kind of tree");
+        }
+        if (mode == MAP_WRITER && (h->seq.load(std::memory_order_acquire) & 1)) {
+            throw std::runtime_error(path + " was left mid-update by a previous writer");
+        }
+    }
+    catch (...) {
+        unmapAll();
+        ::close(fd_);
+        throw;
+    }
+}
+
+template<class Key, class Value>
+MappedAVLTree<Key, Value>::~MappedAVLTree()
+{
+    unmapAll();
+    if (fd_ >= 0) ::close(fd_); // also drops the writer's flock
+}
+
+/**
+* Maps the first bytes of the file, unless the current view already
+* covers them. Offsets do not care where. The previous view stays mapped
+* for lookups still using it.
+*/
+template<class Key, class Value>
+void MappedAVLTree<Key, Value>::mapBytes(size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(remapMutex_);
+    const View* current = view();
+    if (current != nullptr && current->bytes >= bytes) return; // another thread got there first
+    views_.reserve(views_.size() + 1);
+    int prot = (mode_ == MAP_READER) ? PROT_READ : PROT_READ | PROT_WRITE;
+    void* p = ::mmap(nullptr, bytes, prot, MAP_SHARED, fd_, 0);
+    if (p == MAP_FAILED) throw std::system_error(errno, std::generic_category(), "mmap");
+    View* v = new View;
+    v->base = static_cast<char*>(p);
+    v->bytes = bytes;
+    views_.push_back(v);
+    view_.store(v, std::memory_order_release);
+}
+
+template<class Key, class Value>
+void MappedAVLTree<Key, Value>::remapIfGrown() const
+{
+    uint64_t bytes = header()->bytes;
+    if (bytes > view()->bytes) const_cast<MappedAVLTree*>(this)->mapBytes(size_t(bytes));
+}
+
+template<class Key, class Value>
+void MappedAVLTree<Key, Value>::unmapAll()
+{
+    for (size_t i = 0; i < views_.size(); ++i) {
+        ::munmap(views_[i]->base, views_[i]->bytes);
+        delete views_[i];
+    }
+    views_.clear();
+    view_.store(nullptr, std::memory_order_relaxed);
+}
+
+/**
+* Called before each retry of a seqlock read: spins a few times, then
+* sleeps, and gives up once the writer has held the counter odd (or kept
+* moving it) for MAX_READ_RETRIES tries.
+*/
+template<class Key, class Value>
+void MappedAVLTree<Key, Value>::readBackoff(int attempt) const
+{
+    if (attempt >= MAX_READ_RETRIES) {
+        throw std::runtime_error("MappedAVLTree writer has not finished a change; it may have died mid-update");
+    }
+    if (attempt >= 16) ::usleep(READ_BACKOFF_US);
+}
+
+template<class Key, class Value>
+void MappedAVLTree<Key, Value>::requireWriter() const
+{
+    if (mode_ == MAP_READER) throw std::logic_error("MappedAVLTree opened read-only");
+}
+
+/**
+* Makes sure the next allocNode() has a slot, doubling the file if not.
+* Runs before the change starts: growing remaps the writer's view, which
+* would invalidate the node references a change holds.
+*/
+template<class Key, class Value>
+void MappedAVLTree<Key, Value>::reserveNode()
+{
+    Header* h = header();
+    if (h->freeList != 0 || h->next + sizeof(MNode) <= h->bytes) return;
+    uint64_t bytes = h->bytes * 2;
+    if (::ftruncate(fd_, off_t(bytes)) != 0) throw std::system_error(errno, std::generic_category(), "ftruncate");
+    mapBytes(size_t(bytes));
+    header()->bytes = bytes; // only now may readers map that far
+}
+
+template<class Key, class Value>
+uint64_t MappedAVLTree<Key, Value>::allocNode(const Key& key, const Value& value)
+{
+    Header* h = header();
+    uint64_t off = h->freeList;
+    if (off != 0) h->freeList = node(off).left;
+    else {
+        off = h->next;
+        h->next += sizeof(MNode);
+    }
+    MNode& n = node(off);
+    std::memcpy(&n.key, &key, sizeof(Key));
+    std::memcpy(&n.value, &value, sizeof(Value));
+    n.left = 0;
+    n.right = 0;
+    n.balance = 0;
+    ++h->size;
+    return off;
+}
+
+template<class Key, class Value>
+void MappedAVLTree<Key, Value>::freeNode(uint64_t off)
+{
+    Header* h = header();
+    node(off).left = h->freeList;
+    h->freeList = off;
+    --h->size;
+}
+
+template<class Key, class Value>
+void MappedAVLTree<Key, Value>::beginWrite()
+{
+    std::atomic<uint64_t>& seq = header()->seq;
+    seq.store(seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+template<class Key, class Value>
+void MappedAVLTree<Key, Value>::endWrite()
+{
+    std::atomic<uint64_t>& seq = header()->seq;
+    seq.store(seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+template<class Key, class Value>
+void MappedAVLTree<Key, Value>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+    requireWriter();
+    reserveNode();
+    beginWrite();
+    bool grew = false;
+    Header* h = header();
+    h->root = insertAt(h->root, keyValuePair.first, keyValuePair.second, grew);
+    endWrite();
+}
+
+template<class Key, class Value>
+void MappedAVLTree<Key, Value>::remove(const Key& key)
+{
+    requireWriter();
+    beginWrite();
+    bool shrank = false, found = false;
+    Header* h = header();
+    h->root = removeAt(h->root, key, shrank, found);
+    endWrite();
+}
+
+/**
+* Drops every node; the file keeps its size.
+*/
+template<class Key, class Value>
+void MappedAVLTree<Key, Value>::clear()
+{
+    requireWriter();
+    beginWrite();
+    Header* h = header();
+    h->root = 0;
+    h->size = 0;
+    h->next = firstNode();
+    h->freeList = 0;
+    endWrite();
+}
+
+template<class Key, class Value>
+void MappedAVLTree<Key, Value>::sync()
+{
+    requireWriter();
+    const View* v = view();
+    if (::msync(v->base, v->bytes, MS_SYNC) != 0) throw std::system_error(errno, std::generic_category(), "msync");
+}
+
+/**
+* Seqlock read: descend on a copy of each node's fields, retry if the
+* writer was active or finished a change meanwhile. The descent keeps to
+* one view, whatever other threads remap.
+*/
+template<class Key, class Value>
+bool MappedAVLTree<Key, Value>::find(const Key& key, Value& value) const
+{
+    for (int attempt = 1;; readBackoff(attempt++)) {
+        // no reference into the header across the remap below
+        uint64_t before = header()->seq.load(std::memory_order_acquire);
+        if (before & 1) continue; // writer active
+        remapIfGrown();
+
+        const View* v = view();
+        const Header* h = reinterpret_cast<const Header*>(v->base);
+        const uint64_t first = firstNode(), limit = v->bytes - sizeof(MNode);
+        uint64_t off = h->root;
+        bool found = false;
+        for (int depth = 0; depth < MAX_DEPTH; ++depth) {
+            if (off < first || off > limit || (off - first) % sizeof(MNode) != 0) break; // 0 or torn
+            const MNode& n = *reinterpret_cast<const MNode*>(v->base + off);
+            if (key < n.key) off = n.left;
+            else if (n.key < key) off = n.right;
+            else {
+                std::memcpy(&value, &n.value, sizeof(Value));
+                found = true;
+                break;
+            }
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (h->seq.load(std::memory_order_relaxed) == before) return found;
+    }
+}
+
+template<class Key, class Value>
+bool MappedAVLTree<Key, Value>::contains(const Key& key) const
+{
+    Value v;
+    return find(key, v);
+}
+
+template<class Key, class Value>
+size_t MappedAVLTree<Key, Value>::size() const
+{
+    // the header is in every view, so any one will do
+    const std::atomic<uint64_t>& seq = header()->seq;
+    for (int attempt = 1;; readBackoff(attempt++)) {
+        uint64_t before = seq.load(std::memory_order_acquire);
+        uint64_t n = header()->size;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (!(before & 1) && seq.load(std::memory_order_relaxed) == before) return size_t(n);
+    }
+}
+
+/*
+  Rotations and rebalancing over offsets. The balance updates hold for any
+  balances, so inserts and removes share them:
+    rotateLeft(n, r):   n' = n - 1 - max(r, 0),  r' = r - 1 + min(n', 0)
+    rotateRight(n, l):  n' = n + 1 - min(l, 0),  l' = l + 1 + max(n', 0)
+  Each returns the subtree's new root for the caller to link.
+*/
+template<class Key, class Value>
+uint64_t MappedAVLTree<Key, Value>::rotateLeft(uint64_t off)
+{
+    MNode& n = node(off);
+    uint64_t roff = n.right;
+    MNode& r = node(roff);
+    n.right = r.left;
+    r.left = off;
+    n.balance = int8_t(n.balance - 1 - (r.balance > 0 ? r.balance : 0));
+    r.balance = int8_t(r.balance - 1 + (n.balance < 0 ? n.balance : 0));
+    return roff;
+}
+
+template<class Key, class Value>
+uint64_t MappedAVLTree<Key, Value>::rotateRight(uint64_t off)
+{
+    MNode& n = node(off);
+    uint64_t loff = n.left;
+    MNode& l = node(loff);
+    n.left = l.right;
+    l.right = off;
+    n.balance = int8_t(n.balance + 1 - (l.balance < 0 ? l.balance : 0));
+    l.balance = int8_t(l.balance + 1 + (n.balance > 0 ? n.balance : 0));
+    return loff;
+}
+
+/**
+* Restores |balance| <= 1 at a node that reached -2 or 2, with a single or
+* double rotation; returns the subtree's new root.
+*/
+template<class Key, class Value>
+uint64_t MappedAVLTree<Key, Value>::rebalance(uint64_t off)
+{
+    MNode& n = node(off);
+    if (n.balance < -1) {
+        if (node(n.left).balance > 0) n.left = rotateLeft(n.left);
+        return rotateRight(off);
+    }
+    if (n.balance > 1) {
+        if (node(n.right).balance < 0) n.right = rotateRight(n.right);
+        return rotateLeft(off);
+    }
+    return off;
+}
+
+/**
+* Recursive insert under off; grew reports whether the subtree got taller.
+* Returns the subtree's root after rebalancing.
+*/
+template<class Key, class Value>
+uint64_t MappedAVLTree<Key, Value>::insertAt(uint64_t off, const Key& key, const Value& value, bool& grew)
+{
+    if (off == 0) {
+        grew = true;
+        return allocNode(key, value);
+    }
+    MNode& n = node(off);
+    if (key < n.key) {
+        n.left = insertAt(n.left, key, value, grew);
+        if (!grew) return off;
+        --n.balance;
+    }
+    else if (n.key < key) {
+        n.right = insertAt(n.right, key, value, grew);
+        if (!grew) return off;
+        ++n.balance;
+    }
+    else {
+        std::memcpy(&n.value, &value, sizeof(Value));
+        grew = false;
+        return off;
+    }
+    // after an insert, a rebalanced or evened-out subtree is no taller
+    if (n.balance == 0) grew = false;
+    else if (n.balance < -1 || n.balance > 1) {
+        grew = false;
+        return rebalance(off);
+    }
+    return off;
+}
+
+/**
+* Unlinks the smallest node under off into min; shrank as in removeAt.
+*/
+template<class Key, class Value>
+uint64_t MappedAVLTree<Key, Value>::removeMin(uint64_t off, uint64_t& min, bool& shrank)
+{
+    MNode& n = node(off);
+    if (n.left == 0) {
+        min = off;
+        shrank = true;
+        return n.right;
+    }
+    n.left = removeMin(n.left, min, shrank);
+    if (!shrank) return off;
+    ++n.balance;
+    if (n.balance == 1) {
+        shrank = false;
+        return off;
+    }
+    if (n.balance == 0) return off;
+    uint64_t top = rebalance(off);
+    shrank = (node(top).balance == 0);
+    return top;
+}
+
+/**
+* Recursive remove under off; shrank reports whether the subtree got
+* shorter. A node with two children is replaced by its successor, relinked
+* rather than copied.
+*/
+template<class Key, class Value>
+uint64_t MappedAVLTree<Key, Value>::removeAt(uint64_t off, const Key& key, bool& shrank, bool& found)
+{
+    if (off == 0) {
+        shrank = false;
+        return 0;
+    }
+    MNode& n = node(off);
+    int8_t diff;
+    if (key < n.key) {
+        n.left = removeAt(n.left, key, shrank, found);
+        diff = 1;
+    }
+    else if (n.key < key) {
+        n.right = removeAt(n.right, key, shrank, found);
+        diff = -1;
+    }
+    else {
+        found = true;
+        if (n.left == 0 || n.right == 0) {
+            uint64_t child = n.left ? n.left : n.right;
+            freeNode(off);
+            shrank = true;
+            return child;
+        }
+        uint64_t succ = 0;
+        uint64_t right = removeMin(n.right, succ, shrank);
+        MNode& s = node(succ);
+        s.left = n.left;
+        s.right = right;
+        s.balance = n.balance;
+        freeNode(off);
+        off = succ;
+        diff = -1;
+    }
+    if (!shrank) return off;
+
+    MNode& m = node(off);
+    m.balance = int8_t(m.balance + diff);
+    if (m.balance == 1 || m.balance == -1) {
+        shrank = false; // was even: one side is still as tall
+        return off;
+    }
+    if (m.balance == 0) return off;
+    uint64_t top = rebalance(off);
+    shrank = (node(top).balance == 0);
+    return top;
+}
+
+#endif
@@ -0,0 +1,299 @@
+#ifndef SPLAYBST_H
+#define SPLAYBST_H
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <utility>
+#include "bst.h"
+
+/**
+* How SplayTree::find and operator[] restructure the tree.
+*
+*  FULL_SPLAY: top-down splay; the accessed node becomes the root.
+*  SEMI_SPLAY: bottom-up semi-splay (Sleator & Tarjan); a zig-zig step
+*              rotates only the parent, roughly halving the access path
+*              while writing about half as many nodes. Nodes already at
+*              depth <= 1 are left alone, so repeated hits on the hottest
+*              keys do not write at all. Meant for read-mostly workloads.
+*
+* insert and remove always splay fully.
+*/
+enum SplayMode { FULL_SPLAY, SEMI_SPLAY };
+
+/**
+* A self-adjusting binary search tree: recently accessed keys move to the
+* top, so a small (and drifting) hot set stays a few levels deep.
+* Operations are O(log n) amortized; a single operation can be O(n).
+* Uses the plain Node of bst.h.
+*/
+template <class Key, class Value>
+class SplayTree : public BinarySearchTree<Key, Value>
+{
+public:
+    explicit SplayTree(SplayMode mode = FULL_SPLAY);
+
+    virtual void remove(const Key& key) override;
+
+    // lookups restructure the tree; the const overloads do not
+    typename BinarySearchTree<Key, Value>::iterator find(const Key& key);
+    Value& operator[](const Key& key);
+    using BinarySearchTree<Key, Value>::find;
+    using BinarySearchTree<Key, Value>::operator[];
+
+    SplayMode mode() const { return mode_; }
+    void setMode(SplayMode mode) { mode_ = mode; }
+
+    // copy and move are BinarySearchTree's: plain nodes, shape preserved
+    void swap(SplayTree& other)
+    {
+        BinarySearchTree<Key, Value>::swap(other);
+        std::swap(mode_, other.mode_);
+    }
+
+protected:
+    // insert(), at_or_insert() and upsert() splay the key to the root
+    virtual Node<Key, Value>* findOrInsert(const Key& k, const Value& v, bool& created) override;
+    Node<Key, Value>* splay(Node<Key, Value>* t, const Key& key);
+    Node<Key, Value>* semiSplayFind(const Key& key);
+
+    SplayMode mode_;
+};
+
+template<class Key, class Value>
+SplayTree<Key, Value>::SplayTree(SplayMode mode) :
+    BinarySearchTree<Key, Value>(), mode_(mode)
+{
+}
+
+/**
+* Top-down splay of the subtree rooted at t (Sleator & Tarjan). Nodes
+* passed on the way down are hung off a left tree (keys < key) and a right
+* tree (keys > key), tracked by their roots and their innermost nodes.
+* Returns the new subtree root: the node holding key, or the last node on
+* its search path. The returned root has no parent.
+*/
+template<class Key, class Value>
+Node<Key, Value>* SplayTree<Key, Value>::splay(Node<Key, Value>* t, const Key& key)
+{
+    if (t == nullptr) return nullptr;
+    Node<Key, Value>* lRoot = nullptr; // left tree: its largest node is lMax
+    Node<Key, Value>* lMax = nullptr;
+    Node<Key, Value>* rRoot = nullptr; // right tree: its smallest node is rMin
+    Node<Key, Value>* rMin = nullptr;
+
+    while (true) {
+        if (key < t->getKey()) {
+            Node<Key, Value>* l = t->getLeft();
+            if (l == nullptr) break;
+            if (key < l->getKey()) {
+                // zig-zig: rotate right
+                t->setLeft(l->getRight());
+                if (l->getRight()) l->getRight()->setParent(t);
+                l->setRight(t);
+                t->setParent(l);
+                t = l;
+                if (t->getLeft() == nullptr) break;
+            }
+            // link t into the right tree
+            if (rMin) {
+                rMin->setLeft(t);
+                t->setParent(rMin);
+            }
+            else rRoot = t;
+            rMin = t;
+            t = t->getLeft();
+        }
+        else if (t->getKey() < key) {
+            Node<Key, Value>* r = t->getRight();
+            if (r == nullptr) break;
+            if (r->getKey() < key) {
+                // zig-zig: rotate left
+                t->setRight(r->getLeft());
+                if (r->getLeft()) r->getLeft()->setParent(t);
+                r->setLeft(t);
+                t->setParent(r);
+                t = r;
+                if (t->getRight() == nullptr) break;
+            }
+            // link t into the left tree
+            if (lMax) {
+                lMax->setRight(t);
+                t->setParent(lMax);
+            }
+            else lRoot = t;
+            lMax = t;
+            t = t->getRight();
+        }
+        else break;
+    }
+
+    // reassemble: t's subtrees go under the inner ends, the side trees under t
+    if (lMax) {
+        lMax->setRight(t->getLeft());
+        if (t->getLeft()) t->getLeft()->setParent(lMax);
+        t->setLeft(lRoot);
+        lRoot->setParent(t);
+    }
+    if (rMin) {
+        rMin->setLeft(t->getRight());
+        if (t->getRight()) t->getRight()->setParent(rMin);
+        t->setRight(rRoot);
+        rRoot->setParent(t);
+    }
+    t->setParent(nullptr);
+    return t;
+}
+
+/**
+* Plain descent, then a bottom-up semi-splay of the found node (or of the
+* last node on the search path). Returns the node holding key, or nullptr.
+*/
+template<class Key, class Value>
+Node<Key, Value>* SplayTree<Key, Value>::semiSplayFind(const Key& key)
+{
+    Node<Key, Value>* curr = this->root_;
+    Node<Key, Value>* last = nullptr;
+    while (curr != nullptr) {
+        last = curr;
+        if (key < curr->getKey()) curr = curr->getLeft();
+        else if (curr->getKey() < key) curr = curr->getRight();
+        else break;
+    }
+
+    Node<Key, Value>* x = last;
+    while (x != nullptr) {
+        Node<Key, Value>* p = x->getParent();
+        if (p == nullptr) break;
+        Node<Key, Value>* g = p->getParent();
+        if (g == nullptr) break; // depth 1: close enough, no write
+        bool xLeft = (p->getLeft() == x);
+        bool pLeft = (g->getLeft() == p);
+        if (xLeft == pLeft) {
+            // zig-zig: lift the parent only, continue from it
+            if (pLeft) this->rotateRight(g);
+            else this->rotateLeft(g);
+            x = p;
+        }
+        else {
+            // zig-zag: same double rotation as a full splay
+            if (xLeft) {
+                this->rotateRight(p);
+                this->rotateLeft(g);
+            }
+            else {
+                this->rotateLeft(p);
+                this->rotateRight(g);
+            }
+        }
+    }
+    return curr;
+}
+
+/**
+* Returns an iterator to the item with the given key, or end(), after
+* splaying (or semi-splaying) the tree toward key.
+*/
+template<class Key, class Value>
+typename BinarySearchTree<Key, Value>::iterator SplayTree<Key, Value>::find(const Key& key)
+{
+    if (this->root_ == nullptr || !this->mayContain(key)) return this->end();
+    if (mode_ == SEMI_SPLAY) return this->iteratorAt(semiSplayFind(key));
+    this->root_ = splay(this->root_, key);
+    if (key < this->root_->getKey() || this->root_->getKey() < key) return this->end();
+    return this->iteratorAt(this->root_);
+}
+
+/**
+ * @precondition The key exists in the map
+ * Returns the value associated with the key, after splaying toward it
+ */
+template<class Key, class Value>
+Value& SplayTree<Key, Value>::operator[](const Key& key)
+{
+    Node<Key, Value>* n = nullptr;
+    if (this->root_ != nullptr && this->mayContain(key)) {
+        if (mode_ == SEMI_SPLAY) n = semiSplayFind(key);
+        else {
+            this->root_ = splay(this->root_, key);
+            if (!(key < this->root_->getKey() || this->root_->getKey() < key)) n = this->root_;
+        }
+    }
+    if (n == nullptr) throw std::out_of_range("Invalid key");
+    return n->getValue();
+}
+
+/**
+* Splays toward the key, then either returns the root holding it or splits
+* the tree around a new root holding (k, v).
+*/
+template<class Key, class Value>
+Node<Key, Value>* SplayTree<Key, Value>::findOrInsert(const Key& k, const Value& v, bool& created)
+{
+    created = false;
+    if (this->root_ == nullptr) {
+        this->root_ = new Node<Key, Value>(k, v, nullptr);
+        this->nodeCreated(this->root_);
+        created = true;
+        return this->root_;
+    }
+
+    Node<Key, Value>* t = splay(this->root_, k);
+    this->root_ = t;
+    if (!(k < t->getKey() || t->getKey() < k)) return t;
+
+    Node<Key, Value>* n = new Node<Key, Value>(k, v, nullptr);
+    if (k < t->getKey()) {
+        n->setLeft(t->getLeft());
+        if (t->getLeft()) t->getLeft()->setParent(n);
+        t->setLeft(nullptr);
+        n->setRight(t);
+    }
+    else {
+        n->setRight(t->getRight());
+        if (t->getRight()) t->getRight()->setParent(n);
+        t->setRight(nullptr);
+        n->setLeft(t);
+    }
+    t->setParent(n);
+    this->root_ = n;
+    this->nodeCreated(n);
+    created = true;
+    return n;
+}
+
+/**
+* Splays the key to the root, removes it, and joins its subtrees by
+* splaying the largest key of the left subtree to its top.
+*/
+template<class Key, class Value>
+void SplayTree<Key, Value>::remove(const Key& key)
+{
+    if (this->root_ == nullptr || !this->mayContain(key)) return;
+    Node<Key, Value>* t = splay(this->root_, key);
+    this->root_ = t;
+    if (key < t->getKey() || t->getKey() < key) {
+        if (this->filter_) this->filter_->falsePositive();
+        return;
+    }
+
+    Node<Key, Value>* l = t->getLeft();
+    Node<Key, Value>* r = t->getRight();
+    this->nodeDestroyed(t);
+    delete t;
+
+    if (l == nullptr) {
+        if (r) r->setParent(nullptr);
+        this->root_ = r;
+        return;
+    }
+    // every key in l is smaller than key, so l's maximum comes to the top
+    // and has no right child
+    l->setParent(nullptr);
+    l = splay(l, key);
+    l->setRight(r);
+    if (r) r->setParent(l);
+    this->root_ = l;
+}
+
+#endif
@@ -0,0 +1,298 @@
+#ifndef STRINGAVLBST_H
+#define STRINGAVLBST_H
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include "avlbst.h"
+
+/*
+  An AVLTree for std::string keys with faster lookups and prefix scans.
+
+  Keys of 15 bytes or less already live inside the node (std::string's
+  small-string buffer); longer ones sit on the heap, and every comparison on
+  the way down dereferences them. To avoid that, each node caches an 8-byte
+  slice of its key, big-endian and zero padded, so that comparing two slices
+  as integers orders the keys whenever they differ inside the slice. Only a
+  tie falls back to comparing the strings.
+
+  Real key sets tend to share a long head ("https://", "/home/"), which
+  would make every slice equal. So the tree tracks the longest prefix common
+  to all its keys (common_) and takes the slice right after it. A lookup
+  checks the key against common_ once, then descends on slices. An insert
+  that shortens common_ re-slices every node, O(n); that happens at most
+  once per byte of the first key.
+
+  insert() and remove() use the ordinary AVLTree descent. find(), operator[],
+  lower_bound() and prefix_range() use the slices. Like find() on the other
+  trees they consult the membership filter, but they skip the lookup cache.
+*/
+
+/**
+* AVLNode with the cached slice of its key.
+*/
+template <class Value>
+class StringAVLNode : public AVLNode<std::string, Value>
+{
+public:
+    StringAVLNode(const std::string& key, const Value& value, AVLNode<std::string, Value>* parent, size_t skip) :
+        AVLNode<std::string, Value>(key, value, parent), slice_(sliceOf(key, skip))
+    {
+    }
+
+    uint64_t getSlice() const { return slice_; }
+    void reslice(size_t skip) { slice_ = sliceOf(this->getKey(), skip); }
+
+    // bytes [skip, skip + 8) of s as a big-endian integer, zero padded
+    static uint64_t sliceOf(const std::string& s, size_t skip)
+    {
+        uint64_t v = 0;
+        for (size_t i = skip; i < skip + 8; ++i) {
+            v = (v << 8) | (i < s.size() ? uint64_t(static_cast<unsigned char>(s[i])) : 0);
+        }
+        return v;
+    }
+
+protected:
+    uint64_t slice_;
+};
+
+template <class Value, class Stats = NoAVLStats, class Balance = AVLBalance>
+class StringAVLTree : public AVLTree<std::string, Value, Stats, Balance>
+{
+public:
+    typedef typename BinarySearchTree<std::string, Value>::iterator iterator;
+
+    StringAVLTree() {}
+    // O(n) structural copy, like AVLTree's; common_ first, the clones use it
+    StringAVLTree(const StringAVLTree& other) :
+        AVLTree<std::string, Value, Stats, Balance>(), common_(other.common_)
+    {
+        this->stats_ = other.stats_;
+        this->copyFrom(other);
+    }
+    StringAVLTree(StringAVLTree&& other) = default;
+    StringAVLTree& operator=(const StringAVLTree& other)
+    {
+        if (this != &other) {
+            common_ = other.common_;
+            AVLTree<std::string, Value, Stats, Balance>::operator=(other);
+        }
+        return *this;
+    }
+    StringAVLTree& operator=(StringAVLTree&& other) = default;
+    void swap(StringAVLTree& other)
+    {
+        AVLTree<std::string, Value, Stats, Balance>::swap(other);
+        common_.swap(other.common_);
+    }
+    // AVLTree::merge, after bringing both trees' slices to the merged
+    // common prefix
+    void merge(StringAVLTree&& other);
+
+    iterator find(const std::string& key) const;
+    Value& operator[](const std::string& key);
+    Value const & operator[](const std::string& key) const;
+
+    // first key >= key, or end()
+    iterator lower_bound(const std::string& key) const;
+    // [first, last) of the keys starting with prefix, in order
+    std::pair<iterator, iterator> prefix_range(const std::string& prefix) const;
+
+    // length of the prefix every key shares; slices start after it
+    size_t commonPrefixLength() const { return common_.size(); }
+
+protected:
+    virtual AVLNode<std::string, Value>* makeNode(const std::string& key, const Value& value,
+                                                  AVLNode<std::string, Value>* parent) override;
+    virtual Node<std::string, Value>* cloneNode(const Node<std::string, Value>* n,
+                                                Node<std::string, Value>* parent) const override
+    {
+        StringAVLNode<Value>* c = new StringAVLNode<Value>(n->getKey(), n->getValue(),
+                                                           static_cast<AVLNode<std::string, Value>*>(parent),
+                                                           common_.size());
+        c->setBalance(static_cast<const AVLNode<std::string, Value>*>(n)->getBalance());
+        return c;
+    }
+
+    // -1 / 1 if key sorts before / after every key starting with common_,
+    // 0 if key starts with common_
+    int outsideCommon(const std::string& key) const;
+    // three-way comparison of key (whose slice is given) with n's key
+    int compareTo(const std::string& key, uint64_t slice, const StringAVLNode<Value>* n) const;
+    StringAVLNode<Value>* sliceFind(const std::string& key) const;
+
+    // recomputes every node's slice for a common prefix of length skip
+    void resliceAll(size_t skip);
+
+    StringAVLNode<Value>* root() const { return static_cast<StringAVLNode<Value>*>(this->root_); }
+
+    // a prefix of every key in the tree
+    std::string common_;
+};
+
+/**
+* Allocates a StringAVLNode, first shortening common_ (and re-slicing every
+* node) if the new key does not start with it.
+*/
+template<class Value, class Stats, class Balance>
+AVLNode<std::string, Value>* StringAVLTree<Value, Stats, Balance>::makeNode(
+    const std::string& key, const Value& value, AVLNode<std::string, Value>* parent)
+{
+    if (this->root_ == nullptr) common_ = key;
+    else {
+        size_t d = 0;
+        while (d < common_.size() && d < key.size() && common_[d] == key[d]) ++d;
+        if (d < common_.size()) {
+            common_.resize(d);
+            resliceAll(d);
+        }
+    }
+    return new StringAVLNode<Value>(key, value, parent, common_.size());
+}
+
+template<class Value, class Stats, class Balance>
+void StringAVLTree<Value, Stats, Balance>::resliceAll(size_t skip)
+{
+    for (Node<std::string, Value>* n = this->getSmallestNode(); n != nullptr; n = this->successor(n)) {
+        static_cast<StringAVLNode<Value>*>(n)->reslice(skip);
+    }
+}
+
+/**
+* Only this tree is re-sliced, and only if other's keys shorten common_;
+* other's nodes always are, O(m).
+*/
+template<class Value, class Stats, class Balance>
+void StringAVLTree<Value, Stats, Balance>::merge(StringAVLTree&& other)
+{
+    if (&other == this || other.root_ == nullptr) return;
+    if (this->root_ == nullptr) common_ = other.common_;
+    else {
+        size_t d = 0;
+        while (d < common_.size() && d < other.common_.size() && common_[d] == other.common_[d]) ++d;
+        if (d < common_.size()) {
+            common_.resize(d);
+            resliceAll(d);
+        }
+    }
+    other.resliceAll(common_.size());
+    AVLTree<std::string, Value, Stats, Balance>::merge(std::move(other));
+}
+
+template<class Value, class Stats, class Balance>
+int StringAVLTree<Value, Stats, Balance>::outsideCommon(const std::string& key) const
+{
+    size_t d = 0;
+    while (d < common_.size() && d < key.size() && common_[d] == key[d]) ++d;
+    if (d == common_.size()) return 0;
+    if (d == key.size()) return -1; // key is a proper prefix of common_
+    return static_cast<unsigned char>(key[d]) < static_cast<unsigned char>(common_[d]) ? -1 : 1;
+}
+
+template<class Value, class Stats, class Balance>
+int StringAVLTree<Value, Stats, Balance>::compareTo(const std::string& key, uint64_t slice,
+                                                    const StringAVLNode<Value>* n) const
+{
+    if (slice != n->getSlice()) return slice < n->getSlice() ? -1 : 1;
+    // both keys start with common_ and agree on the slice (up to padding)
+    size_t skip = common_.size();
+    return key.compare(skip, std::string::npos, n->getKey(), skip, std::string::npos);
+}
+
+/**
+* Descent on slices; the node holding key, or nullptr.
+*/
+template<class Value, class Stats, class Balance>
+StringAVLNode<Value>* StringAVLTree<Value, Stats, Balance>::sliceFind(const std::string& key) const
+{
+    if (this->root_ == nullptr || !this->mayContain(key)) return nullptr;
+    StringAVLNode<Value>* n = nullptr;
+    if (outsideCommon(key) == 0) {
+        uint64_t slice = StringAVLNode<Value>::sliceOf(key, common_.size());
+        n = root();
+        while (n != nullptr) {
+            int c = compareTo(key, slice, n);
+            if (c < 0) n = static_cast<StringAVLNode<Value>*>(n->getLeft());
+            else if (c > 0) n = static_cast<StringAVLNode<Value>*>(n->getRight());
+            else break;
+        }
+    }
+    if (n == nullptr && this->filter_) this->filter_->falsePositive();
+    return n;
+}
+
+/**
+* Returns an iterator to the item with the given key, or end().
+*/
+template<class Value, class Stats, class Balance>
+typename StringAVLTree<Value, Stats, Balance>::iterator
+StringAVLTree<Value, Stats, Balance>::find(const std::string& key) const
+{
+    return this->iteratorAt(sliceFind(key));
+}
+
+/**
+ * @precondition The key exists in the map
+ * Returns the value associated with the key
+ */
+template<class Value, class Stats, class Balance>
+Value& StringAVLTree<Value, Stats, Balance>::operator[](const std::string& key)
+{
+    StringAVLNode<Value>* n = sliceFind(key);
+    if (n == nullptr) throw std::out_of_range("Invalid key");
+    return n->getValue();
+}
+
+template<class Value, class Stats, class Balance>
+Value const & StringAVLTree<Value, Stats, Balance>::operator[](const std::string& key) const
+{
+    StringAVLNode<Value>* n = sliceFind(key);
+    if (n == nullptr) throw std::out_of_range("Invalid key");
+    return n->getValue();
+}
+
+template<class Value, class Stats, class Balance>
+typename StringAVLTree<Value, Stats, Balance>::iterator
+StringAVLTree<Value, Stats, Balance>::lower_bound(const std::string& key) const
+{
+    if (this->root_ == nullptr) return this->end();
+    int side = outsideCommon(key);
+    if (side < 0) return this->begin();
+    if (side > 0) return this->end();
+
+    uint64_t slice = StringAVLNode<Value>::sliceOf(key, common_.size());
+    StringAVLNode<Value>* best = nullptr;
+    StringAVLNode<Value>* n = root();
+    while (n != nullptr) {
+        int c = compareTo(key, slice, n);
+        if (c > 0) n = static_cast<StringAVLNode<Value>*>(n->getRight());
+        else {
+            best = n;
+            if (c == 0) break;
+            n = static_cast<StringAVLNode<Value>*>(n->getLeft());
+        }
+    }
+    return this->iteratorAt(best);
+}
+
+/**
+* Two O(log n) descents: lower_bound(prefix), and lower_bound of the
+* smallest string greater than every string starting with prefix (drop
+* trailing 0xff bytes, increment the last byte). Walking the range then
+* costs O(k) for k keys.
+*/
+template<class Value, class Stats, class Balance>
+std::pair<typename StringAVLTree<Value, Stats, Balance>::iterator,
+          typename StringAVLTree<Value, Stats, Balance>::iterator>
+StringAVLTree<Value, Stats, Balance>::prefix_range(const std::string& prefix) const
+{
+    iterator first = lower_bound(prefix);
+    std::string past = prefix;
+    while (!past.empty() && static_cast<unsigned char>(past.back()) == 0xff) past.pop_back();
+    if (past.empty()) return std::make_pair(first, this->end());
+    past.back() = static_cast<char>(static_cast<unsigned char>(past.back()) + 1);
+    return std::make_pair(first, lower_bound(past));
+}
+
+#endif
@@ -0,0 +1,161 @@
+#ifndef TREE_METRICS_H
+#define TREE_METRICS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*
+  Single-pass leaf-depth and shape metrics for any binary tree node type.
+
+  treeMetrics(root) walks the tree once with an explicit stack (no
+  recursion, no parent pointers needed) and reports min/max leaf depth,
+  the leaf-depth histogram, and whether the tree has equal paths, is
+  full, perfect, or complete.
+
+  Children are reached through TreeNodeAccess<NodeT>. The primary
+  template calls getLeft()/getRight() (Node<Key,Value>, AVLNode); node
+  types with public left/right members (the struct Node of
+  equal-paths.h) are detected automatically. Other node types can
+  specialize TreeNodeAccess.
+*/
+
+template<class T>
+struct TreeMetricsVoid
+{
+    typedef void type;
+};
+
+/**
+ * Child accessor for node types with getLeft()/getRight().
+ */
+template<class NodeT, class Enable = void>
+struct TreeNodeAccess
+{
+    static const NodeT* left(const NodeT* n) { return n->getLeft(); }
+    static const NodeT* right(const NodeT* n) { return n->getRight(); }
+};
+
+/**
+ * Child accessor for node types with public left/right members.
+ */
+template<class NodeT>
+struct TreeNodeAccess<NodeT, typename TreeMetricsVoid<decltype(std::declval<NodeT&>().left)>::type>
+{
+    static const NodeT* left(const NodeT* n) { return n->left; }
+    static const NodeT* right(const NodeT* n) { return n->right; }
+};
+
+struct TreeMetrics
+{
+    size_t nodes;
+    size_t leaves;
+    size_t height;                          // levels; a single node has height 1
+    int minLeafDepth;                       // root is depth 0; -1 for an empty tree
+    int maxLeafDepth;
+    std::vector<size_t> leafDepthHistogram; // [d] = leaves at depth d
+
+    bool equalPaths;  // every leaf at the same depth
+    bool full;        // every node has 0 or 2 children
+    bool perfect;     // full and equal paths
+    bool complete;    // every level full except the last, which is filled from the left
+
+    TreeMetrics() :
+        nodes(0), leaves(0), height(0), minLeafDepth(-1), maxLeafDepth(-1),
+        equalPaths(true), full(true), perfect(true), complete(true)
+    {
+    }
+
+    std::string toJSON() const
+    {
+        std::ostringstream os;
+        os << "{\"nodes\": " << nodes << ", \"leaves\": " << leaves << ", \"height\": " << height
+           << ", \"min_leaf_depth\": " << minLeafDepth << ", \"max_leaf_depth\": " << maxLeafDepth
+           << ", \"equal_paths\": " << (equalPaths ? "true" : "false")
+           << ", \"full\": " << (full ? "true" : "false")
+           << ", \"perfect\": " << (perfect ? "true" : "false")
+           << ", \"complete\": " << (complete ? "true" : "false")
+           << ", \"leaf_depth_histogram\": [";
+        for (size_t d = 0; d < leafDepthHistogram.size(); ++d) {
+            os << (d ? ", " : "") << leafDepthHistogram[d];
+        }
+        os << "]}";
+        return os.str();
+    }
+};
+
+/**
+ * Computes all metrics in one depth-first pass; O(n) time, O(height) memory.
+ *
+ * Completeness uses heap numbering (root 1, children 2i and 2i+1): the
+ * tree is complete iff the largest number equals the node count.
+ */
+template<class NodeT, class Access>
+TreeMetrics treeMetrics(const NodeT* root, Access)
+{
+    TreeMetrics m;
+    if (root == nullptr) return m;
+
+    struct Item
+    {
+        const NodeT* node;
+        int depth;
+        uint64_t index;
+    };
+    std::vector<Item> stack;
+    Item first = { root, 0, 1 };
+    stack.push_back(first);
+
+    uint64_t maxIndex = 0;
+    bool indexOverflow = false;
+
+    while (!stack.empty()) {
+        Item it = stack.back();
+        stack.pop_back();
+        ++m.nodes;
+        if (size_t(it.depth) + 1 > m.height) m.height = size_t(it.depth) + 1;
+        if (it.index > maxIndex) maxIndex = it.index;
+
+        const NodeT* l = Access::left(it.node);
+        const NodeT* r = Access::right(it.node);
+
+        if (l == nullptr && r == nullptr) {
+            ++m.leaves;
+            if (m.leafDepthHistogram.size() <= size_t(it.depth)) m.leafDepthHistogram.resize(it.depth + 1, 0);
+            ++m.leafDepthHistogram[it.depth];
+            if (m.minLeafDepth == -1 || it.depth < m.minLeafDepth) m.minLeafDepth = it.depth;
+            if (it.depth > m.maxLeafDepth) m.maxLeafDepth = it.depth;
+            continue;
+        }
+        if (l == nullptr || r == nullptr) m.full = false;
+
+        //heap numbers stop fitting in 64 bits below depth 62; such a tree
+        //would need 2^62 nodes to be complete, so it is not
+        if (it.depth >= 62) indexOverflow = true;
+
+        if (r != nullptr) {
+            Item child = { r, it.depth + 1, it.index * 2 + 1 };
+            stack.push_back(child);
+        }
+        if (l != nullptr) {
+            Item child = { l, it.depth + 1, it.index * 2 };
+            stack.push_back(child);
+        }
+    }
+
+    m.equalPaths = (m.minLeafDepth == m.maxLeafDepth);
+    m.perfect = m.full && m.equalPaths;
+    m.complete = !indexOverflow && maxIndex == uint64_t(m.nodes);
+    return m;
+}
+
+template<class NodeT>
+TreeMetrics treeMetrics(const NodeT* root)
+{
+    return treeMetrics(root, TreeNodeAccess<NodeT>());
+}
+
+#endif